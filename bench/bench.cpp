@@ -0,0 +1,412 @@
+/*==============================================================================
+* Copyright 2024 AIPro Inc.
+* Author: Chun-Su Park (cspk@skku.edu)
+=============================================================================*/
+// Benchmark suite (Google Benchmark) of the client-side stages on synthetic inputs.
+// The records (zones, counting lines, ccZones) come from the mock backend, so no model, video or config is needed.
+// Parameters: resolution (width, height), number of boxes and number of channels (see the Args of each benchmark).
+//
+// usage: bench [--benchmark_filter=<regex>] [--benchmark_out=bench.json --benchmark_out_format=json]
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <span>
+#include <vector>
+
+#include <opencv2/imgproc.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "cccanvas.h"
+#include "draw.hpp"
+#include "generator_mock.h"
+#include "util.h"
+
+using namespace std;
+using namespace cv;
+
+#define BENCH_MAX_CHANNELS 16  // channels created by parseConfigAPI of the mock
+#define BENCH_VIDEO_FRAMES 30  // frames of the synthetic video read by BM_Capture
+
+namespace {
+
+struct BenchEnv {
+    Config cfg;
+    vector<CInfo> cInfos;
+    bool ok = false;
+
+    BenchEnv() {
+        MockParams params = mockGetParams();
+        params.numChannels = BENCH_MAX_CHANNELS;
+        params.loadMs = 0.0f;
+        mockConfigure(params);
+
+        if (!parseConfigAPI(cfg, cInfos, "config.json"))
+            return;
+
+        cfg.engineCacheDir.clear();  // nothing written to disk, no warm-up
+        cfg.warmupRuns = 0;
+        ok = initModel(cfg);
+    }
+
+    ~BenchEnv() {
+        if (ok)
+            destroyModel();
+    }
+};
+
+BenchEnv& env() {
+    static BenchEnv e;
+    return e;
+}
+
+/// noise frame (constant content would make encoding unrealistically cheap)
+Mat makeFrame(int width, int height) {
+    Mat frame(height, width, CV_8UC3);
+    theRNG().state = 1234;
+    randu(frame, Scalar::all(0), Scalar::all(255));
+    return frame;
+}
+
+/// tracked person boxes spread over the frame
+vector<DetBox> makeBoxes(int numBoxes, int width, int height) {
+    RNG rng(4321);
+    vector<DetBox> dboxes(numBoxes);
+
+    for (int i = 0; i < numBoxes; i++) {
+        DetBox& d = dboxes[i];
+        d = DetBox{};
+        d.w = rng.uniform(20, std::max(width / 8, 21));
+        d.h = rng.uniform(40, std::max(height / 4, 41));
+        d.x = rng.uniform(0, width - d.w);
+        d.y = rng.uniform(0, height - d.h);
+        d.rx = d.x + d.w / 2;
+        d.ry = d.y + d.h;
+        d.objID = OD_ID_PERSON;
+        d.prob = 0.9f;
+        d.trackID = i + 1;
+        d.patts.setCnt = -1;
+    }
+
+    return dboxes;
+}
+
+void setResolutionLabel(benchmark::State& state, int width, int height) {
+    state.SetLabel(std::format("{}x{}", width, height));
+}
+
+void resolutionArgs(benchmark::internal::Benchmark* b) {
+    for (auto [w, h] : {pair{640, 360}, pair{1280, 720}, pair{1920, 1080}})
+        b->Args({w, h});
+}
+
+void boxArgs(benchmark::internal::Benchmark* b) {
+    for (auto [w, h] : {pair{640, 360}, pair{1280, 720}, pair{1920, 1080}})
+        for (int n : {0, 16, 64, 256})
+            b->Args({w, h, n});
+}
+
+void loopArgs(benchmark::internal::Benchmark* b) {
+    for (auto [w, h] : {pair{640, 360}, pair{1920, 1080}})
+        for (int c : {1, 4, BENCH_MAX_CHANNELS})
+            for (int n : {8, 64})
+                b->Args({c, w, h, n});
+}
+
+}  // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+// Vis primitives
+
+static void BM_VisDrawBoxes(benchmark::State& state) {
+    int width = state.range(0), height = state.range(1), numBoxes = state.range(2);
+    Mat src = makeFrame(width, height), img;
+    vector<Rect> boxes;
+    for (DetBox& d : makeBoxes(numBoxes, width, height))
+        boxes.emplace_back(d.x, d.y, d.w, d.h);
+
+    vector<Scalar> colors(numBoxes, Scalar(50, 255, 255));
+    vector<vector<string>> texts(numBoxes, vector<string>{"12person(90.0):4000(2)"});
+    vector<bool> emphasizes(numBoxes, false);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        src.copyTo(img);
+        state.ResumeTiming();
+
+        Vis::drawBoxes(img, boxes, colors, texts, emphasizes);
+    }
+
+    state.SetItemsProcessed(state.iterations() * numBoxes);
+    setResolutionLabel(state, width, height);
+}
+BENCHMARK(BM_VisDrawBoxes)->Apply(boxArgs);
+
+static void BM_VisDrawTextBlock(benchmark::State& state) {
+    int width = state.range(0), height = state.range(1);
+    Mat img = makeFrame(width, height);
+    vector<string> texts = {"Crowd Counting for Each CZone", "  CZone 0:     12(L1)", "  CZone 1:      3(L0)"};
+
+    for (auto _ : state)
+        Vis::drawTextBlock(img, Point(18, 100), texts, 1, 2);
+
+    setResolutionLabel(state, width, height);
+}
+BENCHMARK(BM_VisDrawTextBlock)->Apply(resolutionArgs);
+
+//////////////////////////////////////////////////////////////////////////////
+// draw functions of the client
+
+static void BM_DrawBoxes(benchmark::State& state) {
+    int width = state.range(0), height = state.range(1), numBoxes = state.range(2);
+    BenchEnv& e = env();
+    if (!e.ok) {
+        state.SkipWithError("mock initialization failed");
+        return;
+    }
+
+    Mat src = makeFrame(width, height), img;
+    vector<DetBox> dboxes = makeBoxes(numBoxes, width, height);
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        src.copyTo(img);
+        state.ResumeTiming();
+
+        drawBoxes(e.cfg, e.cInfos[0].odRcd, img, span<DetBox>(dboxes), 0);
+    }
+
+    state.SetItemsProcessed(state.iterations() * numBoxes);
+    setResolutionLabel(state, width, height);
+}
+BENCHMARK(BM_DrawBoxes)->Apply(boxArgs);
+
+// range(2): boostMode
+static void BM_DrawZones(benchmark::State& state) {
+    int width = state.range(0), height = state.range(1);
+    BenchEnv& e = env();
+    if (!e.ok) {
+        state.SkipWithError("mock initialization failed");
+        return;
+    }
+
+    Config cfg = e.cfg;
+    cfg.boostMode = state.range(2) != 0;
+    Mat img = makeFrame(width, height);
+
+    for (auto _ : state)
+        drawZones(cfg, e.cInfos[0].odRcd, img, 0, 0.7);
+
+    setResolutionLabel(state, width, height);
+}
+BENCHMARK(BM_DrawZones)->ArgsProduct({{640, 1920}, {360, 1080}, {0, 1}});
+
+// range(2): boostMode (the density is blended into the frame only in boostMode)
+static void BM_DrawCC(benchmark::State& state) {
+    int width = state.range(0), height = state.range(1);
+    BenchEnv& e = env();
+    if (!e.ok) {
+        state.SkipWithError("mock initialization failed");
+        return;
+    }
+
+    Config cfg = e.cfg;
+    cfg.boostMode = state.range(2) != 0;
+    Mat src = makeFrame(width, height), img;
+    Mat density(height, width, CV_8UC1);
+    randu(density, Scalar(0), Scalar(64));
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        src.copyTo(img);
+        state.ResumeTiming();
+
+        drawCC(cfg, e.cInfos[0].ccRcd, density, img, 0);
+    }
+
+    setResolutionLabel(state, width, height);
+}
+BENCHMARK(BM_DrawCC)->ArgsProduct({{1280, 1920}, {720, 1080}, {0, 1}});
+
+//////////////////////////////////////////////////////////////////////////////
+// crowd counting records
+
+static void BM_PushCCNum(benchmark::State& state) {
+    BenchEnv& e = env();
+    if (!e.ok) {
+        state.SkipWithError("mock initialization failed");
+        return;
+    }
+
+    CCZone ccZone = e.cInfos[0].ccRcd.ccZones[0];
+    int n = 0;
+
+    for (auto _ : state) {
+        ccZone.pushCCNum(n++ % 40);
+        benchmark::DoNotOptimize(ccZone.ccLevel);
+    }
+}
+BENCHMARK(BM_PushCCNum);
+
+#ifdef _CPU_INFER
+// CCCanvas::setCanvas packs all ccZones of the channel once and then only refills their rois
+static void BM_SetCanvas(benchmark::State& state) {
+    int width = state.range(0), height = state.range(1);
+    BenchEnv& e = env();
+    if (!e.ok) {
+        state.SkipWithError("mock initialization failed");
+        return;
+    }
+
+    CCRecord ccRcd = e.cInfos[0].ccRcd;
+    CCCanvas ccCanvas;
+    Mat frame = makeFrame(width, height);
+
+    for (auto _ : state)
+        ccCanvas.setCanvas(ccRcd, frame);
+
+    setResolutionLabel(state, width, height);
+}
+BENCHMARK(BM_SetCanvas)->Apply(resolutionArgs);
+#endif
+
+//////////////////////////////////////////////////////////////////////////////
+// capture and encode (same codec as VideoStreamer)
+
+static string tempVideo(int width, int height) {
+    return (filesystem::temp_directory_path() / std::format("inet_bench_{}x{}.mp4", width, height)).string();
+}
+
+static void BM_Encode(benchmark::State& state) {
+    int width = state.range(0), height = state.range(1);
+    Mat frame = makeFrame(width, height);
+    string file = tempVideo(width, height);
+
+    VideoWriter writer(file, VideoWriter::fourcc('m', 'p', '4', 'v'), 30, frame.size());
+    if (!writer.isOpened()) {
+        state.SkipWithError("cannot open the video writer");
+        return;
+    }
+
+    for (auto _ : state)
+        writer.write(frame);
+
+    writer.release();
+    filesystem::remove(file);
+    state.SetItemsProcessed(state.iterations());
+    setResolutionLabel(state, width, height);
+}
+BENCHMARK(BM_Encode)->Apply(resolutionArgs)->Unit(benchmark::kMillisecond);
+
+static void BM_Capture(benchmark::State& state) {
+    int width = state.range(0), height = state.range(1);
+    string file = tempVideo(width, height);
+
+    {
+        VideoWriter writer(file, VideoWriter::fourcc('m', 'p', '4', 'v'), 30, Size(width, height));
+        if (!writer.isOpened()) {
+            state.SkipWithError("cannot open the video writer");
+            return;
+        }
+
+        Mat frame = makeFrame(width, height);
+        for (int f = 0; f < BENCH_VIDEO_FRAMES; f++) {
+            frame.col(f % width) = Scalar(255, 255, 255);  // make each frame differ
+            writer.write(frame);
+        }
+    }
+
+    VideoCapture capture(file);
+    Mat frame;
+
+    for (auto _ : state) {
+        if (!capture.read(frame)) {
+            state.PauseTiming();
+            capture.set(CAP_PROP_POS_FRAMES, 0);  // rewind outside the timing
+            state.ResumeTiming();
+
+            if (!capture.read(frame)) {
+                state.SkipWithError("cannot read the synthetic video");
+                break;
+            }
+        }
+    }
+
+    capture.release();
+    filesystem::remove(file);
+    state.SetItemsProcessed(state.iterations());
+    setResolutionLabel(state, width, height);
+}
+BENCHMARK(BM_Capture)->Apply(resolutionArgs)->Unit(benchmark::kMillisecond);
+
+//////////////////////////////////////////////////////////////////////////////
+// full loop against the mock backend: submit OD/FD/CC of every channel, wait, then draw (like main.cpp)
+// range: (channels, width, height, boxes per channel); the inference latencies are those of the mock (MOCK_*_MS)
+
+static void BM_Loop(benchmark::State& state) {
+    int numChannels = state.range(0), width = state.range(1), height = state.range(2);
+    BenchEnv& e = env();
+    if (!e.ok) {
+        state.SkipWithError("mock initialization failed");
+        return;
+    }
+
+    MockParams saved = mockGetParams();
+    MockParams params = saved;
+    params.numObjs = state.range(3);
+    mockConfigure(params);
+
+    Mat src = makeFrame(width, height);
+    vector<Mat> frames(numChannels);
+    vector<CInfo> cInfos(e.cInfos.begin(), e.cInfos.begin() + numChannels);
+    vector<vector<DetBox>> dboxBufs(numChannels, vector<DetBox>(MAX_NUM_DBOXES));
+    vector<Mat> densities(numChannels);
+#ifdef _CPU_INFER
+    vector<CCCanvas> ccCanvases(numChannels);
+#endif
+    vector<int> numBoxes(numChannels), filteredObjCnts(numChannels), detectedClassIDs(numChannels);
+    vector<InferTicket> tickets(3 * numChannels);
+    uint frameCnt = 0;
+    int64_t numDrawn = 0;
+
+    for (auto _ : state) {
+        for (int vchID = 0; vchID < numChannels; vchID++) {
+            src.copyTo(frames[vchID]);
+            CInfo& cInfo = cInfos[vchID];
+
+#ifdef _CPU_INFER
+            ccCanvases[vchID].setCanvas(cInfo.ccRcd, frames[vchID]);  // before OD: the jobs below hold &cInfo
+#endif
+            tickets[3 * vchID] = submitModel(span<DetBox>(dboxBufs[vchID]), numBoxes[vchID], filteredObjCnts[vchID],
+                cInfo, frames[vchID], vchID, frameCnt, e.cfg.odScoreTh);
+            tickets[3 * vchID + 1] = submitModelFD(cInfo.fdRcd, frames[vchID], vchID, detectedClassIDs[vchID]);
+            tickets[3 * vchID + 2] = submitModelCC(densities[vchID], cInfo.ccRcd, frames[vchID], vchID);
+        }
+
+        for (int vchID = 0; vchID < numChannels; vchID++) {
+            CInfo& cInfo = cInfos[vchID];
+            bool result;
+
+            for (int m = 0; m < 3; m++)
+                if (tickets[3 * vchID + m])
+                    waitModel(tickets[3 * vchID + m], result);
+
+            int n = std::clamp(numBoxes[vchID], 0, (int)dboxBufs[vchID].size());
+            drawBoxes(e.cfg, cInfo.odRcd, frames[vchID], span<DetBox>(dboxBufs[vchID].data(), n), vchID);
+            drawFD(e.cfg, cInfo.fdRcd, frames[vchID], vchID, e.cfg.fdScoreThFire, e.cfg.fdScoreThSmoke);
+            drawCC(e.cfg, cInfo.ccRcd, densities[vchID], frames[vchID], vchID);
+            numDrawn += n;
+        }
+
+        frameCnt++;
+    }
+
+    mockConfigure(saved);
+    state.SetItemsProcessed(state.iterations() * numChannels);  // items/s: aggregate frames per second
+    state.counters["boxesPerFrame"] = (double)numDrawn / std::max<int64_t>((int64_t)frameCnt * numChannels, 1);
+    setResolutionLabel(state, width, height);
+}
+BENCHMARK(BM_Loop)->Apply(loopArgs)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+BENCHMARK_MAIN();
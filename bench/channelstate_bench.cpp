@@ -0,0 +1,135 @@
+/*==============================================================================
+* Copyright 2024 AIPro Inc.
+* Author: Chun-Su Park (cspk@skku.edu)
+=============================================================================*/
+// Multi-thread scaling benchmark for the per-channel state layout.
+// Each thread owns one channel and runs the per-frame bookkeeping of main.cpp (read the flags and the OD period, pick
+// the models of the frame, update frameCnt) on the fields of ChannelState. "packed" keeps the states of all channels
+// next to each other (several channels per cache line), "aligned" pads each state to its own cache line like
+// ChannelState. Both variants are the same struct, allocated and accessed the same way, so the difference is false
+// sharing only.
+//
+// usage: bench_channelstate [maxThreads] [itersPerThread]
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#include "global.h"
+
+#define NUM_REPEATS 3  // runs of each variant per thread count
+
+using namespace std;
+using namespace std::chrono;
+
+/// fields of ChannelState (same types and order), without the cache-line alignment
+struct HotState {
+    int vchID;
+    int odMode;
+    bool fdOn;
+    bool ccOn;
+    bool motionGateOn;
+    int odPeriod;
+    unsigned int frameCnt;
+};
+
+/// the same fields, one channel per cache line
+struct alignas(CACHE_LINE_SIZE) AlignedHotState : HotState {};
+
+static_assert(sizeof(HotState) < CACHE_LINE_SIZE, "packed states should share cache lines");
+static_assert(sizeof(AlignedHotState) == CACHE_LINE_SIZE, "aligned states should fill one cache line");
+
+/// models run on the frame (as main.cpp picks them), then count the frame
+static inline int frameStep(unsigned int& frameCnt, int vchID, int odMode, bool fdOn, bool ccOn, bool motionGateOn,
+    int odPeriod) {
+    bool runOD = odMode != OD_MODE_NONE && (frameCnt + vchID) % odPeriod == 0;
+    int runs = (runOD && !motionGateOn) + fdOn + ccOn;  // gated OD is left to the motion gate
+
+    frameCnt++;
+    atomic_signal_fence(memory_order_seq_cst);  // keep the stores inside the loop
+    return runs;
+}
+
+template <typename Fn>
+static double runThreads(int numThreads, Fn fn) {
+    atomic<int> ready{0};
+    atomic<bool> go{false};
+    vector<thread> threads;
+
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            ready++;
+            while (!go.load(memory_order_acquire))
+                this_thread::yield();
+            fn(t);
+        });
+    }
+
+    while (ready.load() < numThreads)
+        this_thread::yield();
+
+    steady_clock::time_point start = steady_clock::now();
+    go.store(true, memory_order_release);
+
+    for (auto& th : threads)
+        th.join();
+
+    return duration_cast<nanoseconds>(steady_clock::now() - start).count();
+}
+
+/// run the per-frame bookkeeping of numThreads channels, one thread per channel (ns per frame)
+template <typename State>
+static double runVariant(int numThreads, long long iters) {
+    vector<State> states(numThreads);
+    for (int c = 0; c < numThreads; c++) {
+        State& s = states[c];
+        s.vchID = c;
+        s.odMode = OD_MODE_RGB;
+        s.fdOn = true;
+        s.ccOn = true;
+        s.motionGateOn = false;
+        s.odPeriod = 2;
+        s.frameCnt = 0;
+    }
+
+    atomic<long long> totalRuns{0};
+    double ns = runThreads(numThreads, [&](int c) {
+        State& s = states[c];
+        long long runs = 0;
+        for (long long i = 0; i < iters; i++)
+            runs += frameStep(s.frameCnt, s.vchID, s.odMode, s.fdOn, s.ccOn, s.motionGateOn, s.odPeriod);
+        totalRuns += runs;  // keeps the model picks alive
+    });
+
+    return ns / iters;
+}
+
+int main(int argc, char** argv) {
+    int maxThreads = argc > 1 ? atoi(argv[1]) : (int)thread::hardware_concurrency();
+    long long iters = argc > 2 ? atoll(argv[2]) : 20000000LL;
+
+    if (maxThreads < 1)
+        maxThreads = 1;
+
+    printf("ChannelState: %zu bytes, alignment %zu\n", sizeof(ChannelState), alignof(ChannelState));
+    printf("%8s %16s %16s %9s\n", "threads", "packed(ns/frame)", "aligned(ns/frame)", "speedup");
+
+    // 1, 2, 4, ... threads, always finishing with maxThreads
+    for (int numThreads = 1;; numThreads = std::min(numThreads * 2, maxThreads)) {
+        // best of alternating runs, so warm-up and frequency changes do not favour either variant
+        double packedNs = 1e30, alignedNs = 1e30;
+        for (int r = 0; r < NUM_REPEATS; r++) {
+            packedNs = std::min(packedNs, runVariant<HotState>(numThreads, iters));
+            alignedNs = std::min(alignedNs, runVariant<AlignedHotState>(numThreads, iters));
+        }
+        printf("%8d %16.2f %17.2f %8.2fx\n", numThreads, packedNs, alignedNs, packedNs / alignedNs);
+
+        if (numThreads == maxThreads)
+            break;
+    }
+
+    return 0;
+}
@@ -0,0 +1,424 @@
+/*==============================================================================
+* Copyright 2024 AIPro Inc.
+* Author: Chun-Su Park (cspk@skku.edu)
+=============================================================================*/
+// Channel-count scaling sweep of the client loop on the mock backend.
+// For every (workers, batch, boostMode) series, the loop of main.cpp (capture, submit OD/FD/CC, wait, draw) runs with
+// 1..maxChannels channels for a fixed time. Each point records the aggregate FPS, the p99 end-to-end latency of the
+// worst channel, the CPU utilization and the RSS. The knee of a series is the first channel count whose scaling
+// efficiency (aggregate FPS / (channels x FPS of one channel)) drops below SWEEP_KNEE_EFFICIENCY, and the real-time
+// limit is the largest channel count at which every channel still reaches the target FPS within the latency budget.
+//
+// workers: client threads behind submitModel* (setInferWorkers)
+// batch: channels submitted together before waiting for their results (also set as cfg.odBatchSize)
+// frames: synthetic noise frames, or the frames of --input (one capture per channel, rewound at the end); a raw replay
+//         (REPLAY_EXT, see tools/video2replay) is memory-mapped per channel, so no decoding is measured
+//
+// usage: scaling_sweep [--channels=16] [--seconds=2] [--workers=1,2,4] [--batches=1,4] [--boost=0,1]
+//                      [--fps=30] [--input=<video or replay>] [--out=scaling]   (writes <out>.csv and <out>.json)
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#include <opencv2/videoio.hpp>
+
+#include "cccanvas.h"
+#include "draw.hpp"
+#include "generator_mock.h"
+#include "latency.h"
+#include "replay.hpp"
+
+using namespace std;
+using namespace cv;
+using namespace std::chrono;
+
+#define SWEEP_KNEE_EFFICIENCY 0.8  // scaling efficiency below which a channel count is a knee
+#define SWEEP_WARMUP_FRAMES 5      // frames of each channel excluded from the measurement
+
+struct SweepOptions {
+    int maxChannels = 16;
+    double seconds = 2.0;
+    vector<int> workers = {1, 2, 4};
+    vector<int> batches = {1, 4};
+    vector<int> boosts = {0, 1};
+    double targetFps = 30.0;  // per channel; the latency budget is one frame interval
+    string input;
+    string out = "scaling";
+};
+
+struct SweepPoint {
+    int workers, batch, boost, channels;
+    double fps;        // aggregate frames per second
+    double minChFps;   // slowest channel
+    int64_t p99Us;     // p99 end-to-end latency of the worst channel
+    int64_t p50Us;     // p50 end-to-end latency over all channels
+    double cpu;        // process CPU time / wall time / hardware threads (0 - 1)
+    double rssMB;      // resident set size at the end of the point
+};
+
+struct SweepSeries {
+    int workers, batch, boost;
+    int knee;         // first channel count below SWEEP_KNEE_EFFICIENCY (0: none)
+    int maxRealtime;  // largest channel count meeting targetFps and the latency budget (0: none)
+    double peakFps;
+    int peakChannels;
+};
+
+static vector<int> parseList(const string& s) {
+    vector<int> v;
+    size_t pos = 0;
+    while (pos < s.size()) {
+        size_t end = s.find(',', pos);
+        if (end == string::npos)
+            end = s.size();
+        v.push_back(atoi(s.substr(pos, end - pos).c_str()));
+        pos = end + 1;
+    }
+    return v;
+}
+
+static bool parseOptions(int argc, char** argv, SweepOptions& opt) {
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        size_t eq = arg.find('=');
+        if (arg.rfind("--", 0) != 0 || eq == string::npos)
+            return false;
+
+        string key = arg.substr(2, eq - 2), value = arg.substr(eq + 1);
+        if (key == "channels")
+            opt.maxChannels = atoi(value.c_str());
+        else if (key == "seconds")
+            opt.seconds = atof(value.c_str());
+        else if (key == "workers")
+            opt.workers = parseList(value);
+        else if (key == "batches")
+            opt.batches = parseList(value);
+        else if (key == "boost")
+            opt.boosts = parseList(value);
+        else if (key == "fps")
+            opt.targetFps = atof(value.c_str());
+        else if (key == "input")
+            opt.input = value;
+        else if (key == "out")
+            opt.out = value;
+        else
+            return false;
+    }
+
+    return opt.maxChannels > 0 && opt.seconds > 0 && !opt.workers.empty() && !opt.batches.empty() &&
+           !opt.boosts.empty();
+}
+
+/// CPU time(us) of the process (all threads)
+static int64_t processCpuUs() {
+#ifdef _WIN32
+    FILETIME createTime, exitTime, kernelTime, userTime;
+    GetProcessTimes(GetCurrentProcess(), &createTime, &exitTime, &kernelTime, &userTime);
+    auto toUs = [](FILETIME ft) { return (((int64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime) / 10; };
+    return toUs(kernelTime) + toUs(userTime);
+#else
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (int64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000 + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+#endif
+}
+
+/// resident set size(MB) of the process
+static double processRssMB() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return 0.0;
+    return pmc.WorkingSetSize / (1024.0 * 1024.0);
+#else
+    long pages = 0, rssPages = 0;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if (!f)
+        return 0.0;
+    if (fscanf(f, "%ld %ld", &pages, &rssPages) != 2)
+        rssPages = 0;
+    fclose(f);
+    return rssPages * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+#endif
+}
+
+/// run the loop with the given parameters and measure it
+static bool runPoint(const SweepOptions& opt, int workers, int batch, int boost, int numChannels, SweepPoint& pt) {
+    MockParams params = mockGetParams();
+    params.numChannels = numChannels;
+    params.loadMs = 0.0f;
+    mockConfigure(params);
+    setInferWorkers(workers);
+
+    Config cfg;
+    vector<CInfo> cInfos;
+    if (!parseConfigAPI(cfg, cInfos, "config.json"))
+        return false;
+
+    cfg.boostMode = boost != 0;
+    cfg.odBatchSize = batch;
+    cfg.engineCacheDir.clear();
+    cfg.warmupRuns = 0;
+    if (!initModel(cfg))
+        return false;
+
+    // sources: one capture per channel (replay), or one shared synthetic frame
+    vector<VideoCapture> captures;
+    vector<unique_ptr<ReplayReader>> replays;
+    vector<size_t> replayPos(numChannels, 0);
+    vector<Mat> replayBufs(numChannels);
+    Mat synthetic;
+    if (opt.input.ends_with(REPLAY_EXT)) {
+        for (int c = 0; c < numChannels; c++) {
+            replays.push_back(make_unique<ReplayReader>());
+            if (!replays.back()->open(opt.input) || replays.back()->size() == 0) {
+                cout << std::format("scaling_sweep: cannot open {}\n", opt.input);
+                destroyModel();
+                return false;
+            }
+        }
+    }
+    else if (!opt.input.empty()) {
+        captures.resize(numChannels);
+        for (VideoCapture& cap : captures) {
+            if (!cap.open(opt.input)) {
+                cout << std::format("scaling_sweep: cannot open {}\n", opt.input);
+                destroyModel();
+                return false;
+            }
+        }
+    }
+    else {
+        synthetic.create(cfg.frameHeights[0], cfg.frameWidths[0], CV_8UC3);
+        randu(synthetic, Scalar::all(0), Scalar::all(255));
+    }
+
+    vector<Mat> frames(numChannels), densities(numChannels);
+#ifdef _CPU_INFER
+    vector<CCCanvas> ccCanvases(numChannels);
+#endif
+    vector<vector<DetBox>> dboxBufs(numChannels, vector<DetBox>(MAX_NUM_DBOXES));
+    vector<int> numBoxes(numChannels), filteredObjCnts(numChannels), detectedClassIDs(numChannels);
+    vector<InferTicket> tickets(3 * numChannels);
+    vector<steady_clock::time_point> starts(numChannels);
+    vector<uint> frameCnts(numChannels, 0);
+    vector<LatencyHistogram> e2e(numChannels);
+
+    steady_clock::time_point begin, deadline;
+    int64_t cpuBegin = 0;
+    bool measuring = false;
+
+    for (int round = 0;; round++) {
+        if (!measuring && round == SWEEP_WARMUP_FRAMES) {
+            measuring = true;
+            begin = steady_clock::now();
+            deadline = begin + microseconds((int64_t)(opt.seconds * 1e6));
+            cpuBegin = processCpuUs();
+            for (LatencyHistogram& h : e2e)
+                h.reset();
+        }
+
+        if (measuring && steady_clock::now() >= deadline)
+            break;
+
+        for (int first = 0; first < numChannels; first += batch) {
+            int last = std::min(first + batch, numChannels);
+
+            for (int vchID = first; vchID < last; vchID++) {
+                CInfo& cInfo = cInfos[vchID];
+                Mat& frame = frames[vchID];
+                starts[vchID] = steady_clock::now();
+
+                if (!replays.empty()) {
+                    ReplayReader& replay = *replays[vchID];
+                    size_t& pos = replayPos[vchID];
+                    replay.release(pos);  // the frame drawn on in the previous round
+                    pos = (pos + 1) % replay.size();
+                    frame = replay.read(pos, replayBufs[vchID]);
+                }
+                else if (!captures.empty()) {
+                    if (!captures[vchID].read(frame)) {
+                        captures[vchID].set(CAP_PROP_POS_FRAMES, 0);
+                        captures[vchID].read(frame);
+                    }
+                }
+                else {
+                    synthetic.copyTo(frame);
+                }
+
+#ifdef _CPU_INFER
+                ccCanvases[vchID].setCanvas(cInfo.ccRcd, frame);  // before OD: the jobs below hold &cInfo
+#endif
+                tickets[3 * vchID] = submitModel(span<DetBox>(dboxBufs[vchID]), numBoxes[vchID],
+                    filteredObjCnts[vchID], cInfo, frame, vchID, frameCnts[vchID], cfg.odScoreTh);
+                tickets[3 * vchID + 1] = submitModelFD(cInfo.fdRcd, frame, vchID, detectedClassIDs[vchID]);
+                tickets[3 * vchID + 2] = submitModelCC(densities[vchID], cInfo.ccRcd, frame, vchID);
+            }
+
+            for (int vchID = first; vchID < last; vchID++) {
+                CInfo& cInfo = cInfos[vchID];
+                Mat& frame = frames[vchID];
+                bool result;
+
+                for (int m = 0; m < 3; m++)
+                    if (tickets[3 * vchID + m])
+                        waitModel(tickets[3 * vchID + m], result);
+
+                int n = std::clamp(numBoxes[vchID], 0, (int)dboxBufs[vchID].size());
+                drawBoxes(cfg, cInfo.odRcd, frame, span<DetBox>(dboxBufs[vchID].data(), n), vchID);
+                drawFD(cfg, cInfo.fdRcd, frame, vchID, cfg.fdScoreThFire, cfg.fdScoreThSmoke);
+                drawCC(cfg, cInfo.ccRcd, densities[vchID], frame, vchID);
+
+                e2e[vchID].record(duration_cast<microseconds>(steady_clock::now() - starts[vchID]).count());
+                frameCnts[vchID]++;
+            }
+        }
+    }
+
+    double sec = duration_cast<microseconds>(steady_clock::now() - begin).count() / 1e6;
+    int64_t cpuUs = processCpuUs() - cpuBegin;
+    destroyModel();
+
+    LatencyHistogram all;
+    pt = SweepPoint{workers, batch, boost, numChannels, 0.0, 1e9, 0, 0, 0.0, 0.0};
+    for (LatencyHistogram& h : e2e) {
+        all.merge(h);
+        pt.minChFps = std::min(pt.minChFps, h.getCount() / sec);
+        pt.p99Us = std::max(pt.p99Us, h.percentile(0.99));
+    }
+
+    pt.fps = all.getCount() / sec;
+    pt.p50Us = all.percentile(0.5);
+    pt.cpu = cpuUs / (sec * 1e6) / std::max(thread::hardware_concurrency(), 1u);
+    pt.rssMB = processRssMB();
+    return true;
+}
+
+static SweepSeries findKnees(const SweepOptions& opt, span<const SweepPoint> points) {
+    SweepSeries s{points[0].workers, points[0].batch, points[0].boost, 0, 0, 0.0, 0};
+    double fps1 = points[0].fps / points[0].channels;
+    int64_t budgetUs = (int64_t)(1e6 / opt.targetFps);
+
+    for (const SweepPoint& pt : points) {
+        if (pt.fps > s.peakFps) {
+            s.peakFps = pt.fps;
+            s.peakChannels = pt.channels;
+        }
+
+        if (s.knee == 0 && fps1 > 0 && pt.fps / (pt.channels * fps1) < SWEEP_KNEE_EFFICIENCY)
+            s.knee = pt.channels;
+
+        if (pt.minChFps >= opt.targetFps && pt.p99Us <= budgetUs)
+            s.maxRealtime = pt.channels;
+    }
+
+    return s;
+}
+
+static bool writeCSV(const string& filename, const vector<SweepPoint>& points) {
+    ofstream out(filename);
+    if (!out)
+        return false;
+
+    out << "workers,batch,boost,channels,fps,min_ch_fps,p50_us,p99_us,cpu,rss_mb\n";
+    for (const SweepPoint& pt : points)
+        out << std::format("{},{},{},{},{:.2f},{:.2f},{},{},{:.3f},{:.1f}\n", pt.workers, pt.batch, pt.boost,
+            pt.channels, pt.fps, pt.minChFps, pt.p50Us, pt.p99Us, pt.cpu, pt.rssMB);
+
+    return (bool)out;
+}
+
+static bool writeJSON(const string& filename, const SweepOptions& opt, const vector<SweepPoint>& points,
+    const vector<SweepSeries>& series) {
+    ofstream out(filename);
+    if (!out)
+        return false;
+
+    out << std::format("{{\n  \"targetFps\": {},\n  \"kneeEfficiency\": {},\n  \"hardwareThreads\": {},\n",
+        opt.targetFps, SWEEP_KNEE_EFFICIENCY, thread::hardware_concurrency());
+
+    out << "  \"series\": [\n";
+    for (size_t i = 0; i < series.size(); i++) {
+        const SweepSeries& s = series[i];
+        out << std::format("    {{\"workers\": {}, \"batch\": {}, \"boost\": {}, \"knee\": {}, \"maxRealtime\": {}, "
+                           "\"peakFps\": {:.2f}, \"peakChannels\": {}}}{}\n",
+            s.workers, s.batch, s.boost, s.knee, s.maxRealtime, s.peakFps, s.peakChannels,
+            i + 1 < series.size() ? "," : "");
+    }
+
+    out << "  ],\n  \"points\": [\n";
+    for (size_t i = 0; i < points.size(); i++) {
+        const SweepPoint& pt = points[i];
+        out << std::format("    {{\"workers\": {}, \"batch\": {}, \"boost\": {}, \"channels\": {}, \"fps\": {:.2f}, "
+                           "\"minChFps\": {:.2f}, \"p50Us\": {}, \"p99Us\": {}, \"cpu\": {:.3f}, "
+                           "\"rssMB\": {:.1f}}}{}\n",
+            pt.workers, pt.batch, pt.boost, pt.channels, pt.fps, pt.minChFps, pt.p50Us, pt.p99Us, pt.cpu, pt.rssMB,
+            i + 1 < points.size() ? "," : "");
+    }
+    out << "  ]\n}\n";
+
+    return (bool)out;
+}
+
+int main(int argc, char** argv) {
+    SweepOptions opt;
+    if (!parseOptions(argc, argv, opt)) {
+        printf("usage: scaling_sweep [--channels=16] [--seconds=2] [--workers=1,2,4] [--batches=1,4] [--boost=0,1]\n"
+               "                     [--fps=30] [--input=<video or replay>] [--out=scaling]\n");
+        return -1;
+    }
+
+    vector<SweepPoint> points;
+    vector<SweepSeries> series;
+
+    for (int workers : opt.workers) {
+        for (int batch : opt.batches) {
+            for (int boost : opt.boosts) {
+                size_t first = points.size();
+
+                for (int c = 1; c <= opt.maxChannels; c++) {
+                    SweepPoint pt;
+                    if (!runPoint(opt, workers, batch, boost, c, pt)) {
+                        printf("scaling_sweep: initialization failed\n");
+                        return -1;
+                    }
+
+                    printf("workers %d, batch %d, boost %d, channels %2d: %8.1f fps (min ch %6.1f), p99 %7.2f ms, "
+                           "cpu %5.1f%%, rss %7.1f MB\n",
+                        workers, batch, boost, c, pt.fps, pt.minChFps, pt.p99Us / 1000.0, pt.cpu * 100, pt.rssMB);
+                    points.push_back(pt);
+                }
+
+                series.push_back(findKnees(opt, span<const SweepPoint>(points).subspan(first)));
+            }
+        }
+    }
+
+    printf("\n%-8s%-7s%-7s%8s%14s%12s%14s\n", "workers", "batch", "boost", "knee", "max realtime", "peak fps",
+        "peak channels");
+    for (const SweepSeries& s : series)
+        printf("%-8d%-7d%-7d%8d%14d%12.1f%14d\n", s.workers, s.batch, s.boost, s.knee, s.maxRealtime, s.peakFps,
+            s.peakChannels);
+
+    bool ok = writeCSV(opt.out + ".csv", points) && writeJSON(opt.out + ".json", opt, points, series);
+    printf("\n%s %s.csv, %s.json\n", ok ? "written:" : "cannot write", opt.out.c_str(), opt.out.c_str());
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,321 @@
+#include "draw.hpp"
+
+#include <format>
+#include <string>
+#include <vector>
+
+#include <opencv2/imgproc.hpp>
+
+#include "util.h"
+
+using namespace std;
+using namespace cv;
+
+void drawZones(Config& cfg, ODRecord& odRcd, Mat& img, int vchID, double alpha) {
+    if (cfg.boostMode) {
+        int np[1] = { 4 };
+        cv::Mat layer;
+
+        for (Zone& zone : odRcd.zones) {
+            if (zone.vchID == vchID) {
+                if (layer.empty())
+                    layer = img.clone();
+
+                int z = zone.zoneID;
+                const Scalar color(255, 50, 50);
+                fillPoly(layer, { zone.pts }, color);
+            }
+        }
+
+        if (!layer.empty())
+            cv::addWeighted(img, alpha, layer, 1 - alpha, 0, img);
+    }
+    else {
+        for (Zone& zone : odRcd.zones) {
+            if (zone.vchID == vchID) {
+                const Scalar color(255, 20, 20);
+                polylines(img, { zone.pts }, true, color, 2);
+            }
+        }
+    }
+}
+
+
+void drawBoxes(Config& cfg, ODRecord& odRcd, Mat& img, span<DetBox> dboxes, int vchID, double alpha) {
+    const string* objNames = cfg.odIDMapping.data();
+    time_t now = time(NULL);
+
+    vector<Rect> boxes;
+    vector<Scalar> boxesColor;
+    vector<bool> emphasizes;
+    vector<vector<string>> boxTexts;
+    int boxCnt = 0;
+
+    for (auto& dbox : dboxes) {
+        if (dbox.objID >= cfg.numClasses)
+            continue;
+
+        int label = dbox.objID;
+        if (dbox.prob < cfg.odScoreTh)
+            continue;  // should check scores are ordered. Otherwise, use continue
+
+        boxCnt++;
+        Rect box(dbox.x, dbox.y, dbox.w, dbox.h);
+        boxes.push_back(box);
+
+        Scalar boxColor(50, 255, 255);
+        vector<string> texts;
+
+        bool isFemale;
+        int probFemale;
+
+        if (cfg.parEnable && dbox.patts.setCnt != -1) {
+            PedAtts::getGenderAtt(dbox.patts, isFemale, probFemale);
+            boxColor = isFemale ? Scalar(80, 80, 255) : Scalar(255, 80, 80);
+        }
+
+        int partitionIdx = (dbox.y + dbox.h) / (img.rows / 4);  //(dbox.y + dbox.h): 0 ~ H-1
+        // boxColor = Scalar(0, 255, 0); //for hsw
+
+        if (DRAW_DETECTION_INFO) {
+            //string objName = objNames[label];
+            //string objName = objNames[label] + "(" + to_string((int)(dbox.prob * 100 + 0.5)) + "%)";
+            string objName = std::format("{}{}({:.1f}):{}({})", dbox.trackID, objNames[label], dbox.prob * 100 + 0.5, dbox.w * dbox.h, partitionIdx);
+            //string objName = std::format("{}({:.1f}):{}({})", objNames[label], dbox.prob * 100 + 0.5, dbox.w * dbox.h, partitionIdx);
+            // string objName = to_string(dbox.trackID) + objNames[label] + "(" + to_string((int)(dbox.prob * 100 +
+            // 0.5)) + "%)";
+            // string objName = to_string(dbox.trackID);
+
+            // char buf[80];
+            // tm *curTm = localtime(&dbox.inTime);
+            // strftime(buf, sizeof(buf), "Time: %H:%M:%S", curTm);
+            // string timeInfo = string(buf);
+
+            texts.push_back(objName);
+            // vector<string> texts{objName, timeInfo};
+
+            if (label == OD_ID_PERSON) {
+                //string trkInfo;
+                //int period = now - dbox.inTime;
+                //if (period < cfg.longLastingObjTh) {  // no action
+                //    trkInfo = "ET: " + to_string(period) + " (" + to_string((int)dbox.distVar) + ")";
+                //}
+                //else {                              // action (Sleep or Hang around)
+                //    if (dbox.distVar < cfg.noMoveTh)  // Sleep event
+                //        trkInfo = "ET: " + to_string(period) + ", No movement(" + to_string((int)dbox.distVar) + ")";
+                //    else  // Hang around event
+                //        trkInfo = "ET: " + to_string(period) + ", Hang around(" + to_string((int)dbox.distVar) + ")";
+                //}
+                //texts.push_back(trkInfo);
+
+                if (cfg.parEnable && dbox.patts.setCnt != -1) {
+                    string genderInfo, ageGroupInfo;
+                    int ageGroup, probAgeGroup;
+
+                    genderInfo = "Gen: " + string((isFemale ? "F" : "M")) + " (" + to_string(probFemale) + "%)" +
+                        to_string(dbox.patts.setCnt);
+                    texts.push_back(genderInfo);
+
+                    PedAtts::getAgeGroupAtt(dbox.patts, ageGroup, probAgeGroup);
+                    ageGroupInfo =
+                        "Age: " +
+                        string(ageGroup == CHILD_GROUP ? "child" : (ageGroup == ADULT_GROUP ? "adult" : "elder")) +
+                        " (" + to_string(probAgeGroup) + "%)";
+                    texts.push_back(ageGroupInfo);
+                }
+            }
+        }
+
+        boxesColor.push_back(boxColor);
+        boxTexts.push_back(texts);
+
+        if ((DRAW_CNTLINE && (dbox.justCountedLine > 0)) || (DRAW_ZONE && (dbox.justCountedZone > 0)))
+            emphasizes.push_back(true);
+        else
+            emphasizes.push_back(false);
+    }
+
+    Vis::drawBoxes(img, boxes, boxesColor, boxTexts, emphasizes);
+
+    //vector<string> boxCountText = { to_string(boxCnt) };
+    //Vis::drawTextBlock(img, Point(900, 100), boxCountText, 2, 2, Scalar(0, 0, 0), Scalar(0, 255, 0));
+
+    if (DRAW_ZONE)
+        drawZones(cfg, odRcd, img, vchID, alpha);
+
+    // draw par results
+    if (DRAW_ZONE_COUNTING) {
+        vector<string> texts = { "People Counting for Each Zone" };
+
+        for (Zone& zone : odRcd.zones) {
+            int curMTotal, curFTotal;
+            curMTotal = zone.curPeople[0][0] + zone.curPeople[0][1] + zone.curPeople[0][2];
+            curFTotal = zone.curPeople[1][0] + zone.curPeople[1][1] + zone.curPeople[1][2];
+
+            string title = " Zone " + to_string(zone.zoneID);
+            string cur = "   Cur> M: " + to_string(curMTotal) + "(" + to_string(zone.curPeople[0][0]) + ", " +
+                to_string(zone.curPeople[0][1]) + ", " + to_string(zone.curPeople[0][2]) + "), " +
+                " F: " + to_string(curFTotal) + "(" + to_string(zone.curPeople[1][0]) + ", " +
+                to_string(zone.curPeople[1][1]) + ", " + to_string(zone.curPeople[1][2]) + ")";
+
+            int hitMTotal, hitFTotal;
+            hitMTotal = zone.hitMap[0][0] + zone.hitMap[0][1] + zone.hitMap[0][2];
+            hitFTotal = zone.hitMap[1][0] + zone.hitMap[1][1] + zone.hitMap[1][2];
+
+            string hit = "   Hit> M: " + to_string(hitMTotal) + "(" + to_string(zone.hitMap[0][0]) + ", " +
+                to_string(zone.hitMap[0][1]) + ", " + to_string(zone.hitMap[0][2]) + "), " +
+                " F: " + to_string(hitFTotal) + "(" + to_string(zone.hitMap[1][0]) + ", " +
+                to_string(zone.hitMap[1][1]) + ", " + to_string(zone.hitMap[1][2]) + ")";
+
+            texts.push_back(title);
+            texts.push_back(cur);
+            texts.push_back(hit);
+        }
+
+        Vis::drawTextBlock(img, Point(18, 500), texts, 1, 2);
+    }
+
+    if (DRAW_CNTLINE) {
+        for (CntLine& cntLine : odRcd.cntLines) {
+            line(img, cntLine.pts[0], cntLine.pts[1], Scalar(50, 255, 50), 2, LINE_8);
+        }
+    }
+
+    // draw couniting results
+    if (DRAW_CNTLINE_COUNTING) {
+        vector<string> texts = { "People Counting for Each Line" };
+
+        for (CntLine& cntLine : odRcd.cntLines) {
+            int upMTotal, upFTotal;
+            upMTotal = cntLine.totalUL[0][0] + cntLine.totalUL[0][1] + cntLine.totalUL[0][2];
+            upFTotal = cntLine.totalUL[1][0] + cntLine.totalUL[1][1] + cntLine.totalUL[1][2];
+
+            string title = " Counting Line " + to_string(cntLine.clineID);
+            string up = "   U/L> M: " + to_string(upMTotal) + "(" + to_string(cntLine.totalUL[0][0]) + ", " +
+                to_string(cntLine.totalUL[0][1]) + ", " + to_string(cntLine.totalUL[0][2]) + "), " +
+                " F: " + to_string(upFTotal) + "(" + to_string(cntLine.totalUL[1][0]) + ", " +
+                to_string(cntLine.totalUL[1][1]) + ", " + to_string(cntLine.totalUL[1][2]) + ")";
+
+            int dwMTotal, dwFTotal;
+            dwMTotal = cntLine.totalDR[0][0] + cntLine.totalDR[0][1] + cntLine.totalDR[0][2];
+            dwFTotal = cntLine.totalDR[1][0] + cntLine.totalDR[1][1] + cntLine.totalDR[1][2];
+
+            string dw = "   D/R> M: " + to_string(dwMTotal) + "(" + to_string(cntLine.totalDR[0][0]) + ", " +
+                to_string(cntLine.totalDR[0][1]) + ", " + to_string(cntLine.totalDR[0][2]) + "), " +
+                " F: " + to_string(dwFTotal) + "(" + to_string(cntLine.totalDR[1][0]) + ", " +
+                to_string(cntLine.totalDR[1][1]) + ", " + to_string(cntLine.totalDR[1][2]) + ")";
+
+            texts.push_back(title);
+            texts.push_back(up);
+            texts.push_back(dw);
+        }
+
+        Vis::drawTextBlock(img, Point(18, 140), texts, 1, 2);
+    }
+}
+
+void drawFD(Config& cfg, FDRecord& fdRcd, Mat& img, int vchID, float fdScoreThFire, float fdScoreThSmoke) {
+    time_t now = time(NULL);
+    int h = img.rows;
+    int w = img.cols;
+    string strFire = "X", strSmoke = "X";
+
+    if (h < 500 || w < 800)
+        return;
+
+    const int fx = w - 190, fy = 290;
+    const vector<Point> ptsFire = { Point(fx + 0, fy + 54),  Point(fx + 24, fy + 0),  Point(fx + 45, fy + 48),
+                                   Point(fx + 54, fy + 21), Point(fx + 63, fy + 54), Point(fx + 54, fy + 87),
+                                   Point(fx + 15, fy + 87) };
+
+    const int sx = w - 100, sy = 290;
+    const vector<Point> ptsSmoke = { Point(sx + 0, sy + 51),  Point(sx + 0, sy + 30),  Point(sx + 21, sy + 0),
+                                    Point(sx + 21, sy + 33), Point(sx + 63, sy + 42), Point(sx + 54, sy + 60),
+                                    Point(sx + 36, sy + 87), Point(sx + 36, sy + 65) };
+
+    if (fdRcd.fireProbs.back() > fdScoreThFire) {
+        /// draw canvas
+        Mat fdIconRegion = img(Rect(Point(fx - 4, fy - 2), Point(fx + 63 + 4, fy + 87 + 2)));
+        fdIconRegion -= Scalar(100, 100, 100);
+        fillPoly(img, ptsFire, Scalar(0, 0, 255));
+
+        strFire = "O";
+    }
+
+    if (fdRcd.smokeProbs.back() > fdScoreThSmoke) {
+        Mat smokeIconRegion = img(Rect(Point(sx - 4, sy - 2), Point(sx + 63 + 4, sy + 87 + 2)));
+        smokeIconRegion -= Scalar(100, 100, 100);
+        fillPoly(img, ptsSmoke, Scalar(200, 200, 200));
+
+        strSmoke = "O";
+    }
+
+    string fdText = "Event> Fire: " + strFire + ", Smoke: " + strSmoke;
+    Vis::drawTextBlockFD(img, fdRcd, vchID, 140, fdText, 1, 2);
+
+    // if (cfg.boostMode && (strSmoke == "O" || strFire == "O"))
+    //    rectangle(img, Rect(0, 0, img.cols, img.rows), Scalar(0, 0, 255), 4);    
+}
+
+void drawCC(Config& cfg, CCRecord& ccRcd, Mat& density, Mat& img, int vchID) {
+    if (cfg.boostMode) {
+        if (!density.empty()) {
+            vector<Mat> chans(3);
+
+            split(img, chans);
+            chans[2] += density;  // add to red channel
+            merge(chans, img);
+        }
+
+        float alpha = 0.7f;
+        int np[1] = { 4 };
+        cv::Mat layer;
+
+        for (CCZone& ccZone : ccRcd.ccZones) {
+            if (layer.empty())
+                layer = img.clone();
+
+            int z = ccZone.ccZoneID;
+            const Scalar color(50, 50, 255);
+            fillPoly(layer, { ccZone.pts }, color);
+        }
+
+        if (!layer.empty())
+            cv::addWeighted(img, alpha, layer, 1 - alpha, 0, img);
+    }
+    else {
+        for (CCZone& ccZone : ccRcd.ccZones) {
+            const Scalar color(20, 20, 255);
+            polylines(img, { ccZone.pts }, true, color, 2);
+        }
+    }
+
+    if (img.rows < 720 || img.cols < 1280)
+        return;
+
+    ////////////////////
+    // draw couniting results
+
+    vector<string> ccTexts;
+    ccTexts.push_back(string("Crowd Counting for Each CZone"));
+
+#ifndef _CPU_INFER
+    ccTexts.push_back(std::format("  Entire Area:{:>5}", ccRcd.ccNumFrames.back()));
+#endif
+
+    for (CCZone& ccZone : ccRcd.ccZones) {
+        string text =
+            // std::format(" -CZone {}: {:>4}", ccZone.ccZoneID+1, ccZone.ccNums.back());
+            std::format("  CZone {}:{:>7}(L{})", ccZone.ccZoneID, ccZone.ccNums.back(), ccZone.ccLevel);
+        ccTexts.push_back(text);
+    }
+
+    Vis::drawTextBlock(img, Point(img.cols - 555, 100), ccTexts, 1, 2);
+
+    // for demo
+    //vector<string> tmp0 = {string("CZone 0")};
+    //Vis::drawTextBlock(img, Point(640, 250), tmp0, 1, 2);
+
+    //vector<string> tmp1 = { string("CZone 1") };
+    //Vis::drawTextBlock(img, Point(640, 600), tmp1, 1, 2);    
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <span>
+
+#include <opencv2/core/core.hpp>
+
+#include "global.h"
+
+#define DRAW_DETECTION_BOXES true
+#define DRAW_DETECTION_INFO true
+#define DRAW_CNTLINE true
+#define DRAW_CNTLINE_COUNTING false
+#define DRAW_ZONE true
+#define DRAW_ZONE_COUNTING false
+#define DRAW_FIRE_DETECTION true
+#define DRAW_CC true
+
+/// zones of a channel (boostMode: filled with alpha blending, otherwise outlines)
+void drawZones(Config& cfg, ODRecord& odRcd, cv::Mat& img, int vchID, double alpha);
+
+/// detection boxes, counting lines and zones of a channel
+void drawBoxes(Config& cfg, ODRecord& odRcd, cv::Mat& img, std::span<DetBox> dboxes, int vchID, double alpha = 0.7);
+
+/// fire and smoke icons of a channel
+void drawFD(Config& cfg, FDRecord& fdRcd, cv::Mat& img, int vchID, float fdScoreThFire, float fdScoreThSmoke);
+
+/// density map and crowd counting zones of a channel
+void drawCC(Config& cfg, CCRecord& ccRcd, cv::Mat& density, cv::Mat& img, int vchID);
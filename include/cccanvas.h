@@ -0,0 +1,386 @@
+/*==============================================================================
+* Copyright 2024 AIPro Inc.
+* Author: Chun-Su Park (cspk@skku.edu)
+=============================================================================*/
+#pragma once
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "global.h"
+
+#ifdef _CPU_INFER
+#define CC_PACK_GAP 8          /// gap between packed rois in the cc canvas (keeps the density of neighbouring zones apart)
+#define CC_PACK_MIN_SCALE 0.05  /// smallest uniform scale of the rois tried by the packer
+
+/// skyline(bottom-left) bin packer for placing rectangles in a fixed-size canvas
+struct SkylinePacker {
+    struct Node {
+        int x, y, w;  /// segment [x, x + w) of the skyline at height y
+    };
+
+    int width, height;
+    std::vector<Node> skyline;
+
+    void init(int _width, int _height) {
+        width = _width;
+        height = _height;
+        skyline.assign(1, Node{0, 0, width});
+    }
+
+    /// place a rectangle of the given size (false if it does not fit)
+    bool insert(cv::Size size, cv::Rect& rect) {
+        int bestIdx = -1, bestTop = INT_MAX, bestX = INT_MAX, bestY = 0;
+
+        for (int i = 0; i < (int)skyline.size(); i++) {
+            int y;
+            if (!fit(i, size, y))
+                continue;
+
+            if (y + size.height < bestTop || (y + size.height == bestTop && skyline[i].x < bestX)) {
+                bestIdx = i;
+                bestTop = y + size.height;
+                bestX = skyline[i].x;
+                bestY = y;
+            }
+        }
+
+        if (bestIdx < 0)
+            return false;
+
+        rect = cv::Rect(bestX, bestY, size.width, size.height);
+        skyline.insert(skyline.begin() + bestIdx, Node{bestX, bestTop, size.width});
+
+        for (int i = bestIdx + 1; i < (int)skyline.size();) {
+            Node& prev = skyline[i - 1];
+            Node& cur = skyline[i];
+
+            if (cur.x >= prev.x + prev.w)
+                break;
+
+            int shrink = prev.x + prev.w - cur.x;
+            cur.x += shrink;
+            cur.w -= shrink;
+
+            if (cur.w > 0)
+                break;
+
+            skyline.erase(skyline.begin() + i);
+        }
+
+        for (int i = 0; i + 1 < (int)skyline.size();) {
+            if (skyline[i].y == skyline[i + 1].y) {
+                skyline[i].w += skyline[i + 1].w;
+                skyline.erase(skyline.begin() + i + 1);
+            }
+            else {
+                i++;
+            }
+        }
+
+        return true;
+    }
+
+   private:
+    bool fit(int idx, cv::Size size, int& y) {
+        int x = skyline[idx].x;
+        if (x + size.width > width)
+            return false;
+
+        y = 0;
+        for (int i = idx, remaining = size.width; remaining > 0; i++) {
+            y = std::max(y, skyline[i].y);
+            if (y + size.height > height)
+                return false;
+
+            remaining -= skyline[i].w;
+        }
+
+        return true;
+    }
+};
+
+/// remap table and polygon spans of a ccZone in its canvas (client side, see CCCanvas)
+struct CCZoneRemap {
+    std::vector<int> xOfs;         /// byte offsets of the left/right source pixels for each roiCanvas column
+    std::vector<short> xWeights;   /// weight of the right source pixel for each roiCanvas column
+    std::vector<int> yRows;        /// top/bottom source rows for each roiCanvas row
+    std::vector<short> yWeights;   /// weight of the bottom source row for each roiCanvas row
+    std::vector<cv::Vec2i> spans;  /// [start, end) columns inside the polygon for each roiCanvas row
+    cv::Rect rect;                 /// location of roiCanvas in the canvas of the zone (empty: the zone has no canvas)
+};
+
+/// @brief CC canvases of a channel (CPU path, client side)
+/// The scaled rois of all ccZones of a CCRecord are packed into one NET_WIDTH_CC x NET_HEIGHT_CC canvas, so one
+/// runModelCC call serves all zones. When the zones do not fit even at CC_PACK_MIN_SCALE, every zone gets a canvas of
+/// its own with the roi at the origin (as CCZone::initCanvas does). The layout is only recomputed when the frame size
+/// or the zone geometry changes.
+/// Each roi is filled in one pass: a bilinear remap table (the same sampling positions as cv::resize with
+/// INTER_LINEAR, 11-bit fixed-point weights) resamples only the pixels inside the polygon, straight into roiCanvas.
+/// CCRecord and CCZone are shared with the backend, so the layout and the remap tables live here, keyed by ccZoneID;
+/// only the baseline members of CCZone (canvas, roiCanvas, mask, roi) are set for the backend.
+/// Only the input side changes: runModelCC still returns a frame-sized density and the ccNums of the backend.
+class CCCanvas {
+   public:
+    /// fill the canvases of all ccZones of ccRcd from frame
+    void setCanvas(CCRecord& ccRcd, cv::Mat& frame) {
+        size_t key = geometryKey(ccRcd, frame);
+        if (!laidOut || key != layoutKey) {
+            remaps.clear();
+            packed = pack(ccRcd, frame);
+            if (!packed)
+                placeEach(ccRcd, frame);
+
+            layoutKey = key;
+            laidOut = true;
+        }
+
+        for (CCZone& ccZone : ccRcd.ccZones) {
+            auto it = remaps.find(ccZone.ccZoneID);
+            if (it != remaps.end() && !it->second.rect.empty())
+                fill(ccZone, it->second, frame);
+        }
+    }
+
+    /// all ccZones share one canvas (false: one canvas per zone, the zones did not fit)
+    bool isPacked() const {
+        return packed;
+    }
+
+    /// location of the roiCanvas of a ccZone in its canvas (empty: no canvas)
+    cv::Rect getRect(int ccZoneID) const {
+        auto it = remaps.find(ccZoneID);
+        return it != remaps.end() ? it->second.rect : cv::Rect();
+    }
+
+   private:
+    size_t geometryKey(CCRecord& ccRcd, cv::Mat& frame) {
+        std::hash<int> h;
+        size_t key = h(frame.cols) ^ (h(frame.rows) << 1);
+
+        for (CCZone& ccZone : ccRcd.ccZones) {
+            key ^= h(ccZone.ccZoneID) + 0x9e3779b9 + (key << 6) + (key >> 2);
+            for (cv::Point& pt : ccZone.pts) {
+                key ^= h(pt.x) + 0x9e3779b9 + (key << 6) + (key >> 2);
+                key ^= h(pt.y) + 0x9e3779b9 + (key << 6) + (key >> 2);
+            }
+        }
+
+        return key;
+    }
+
+    /// place all zones in one canvas, shrinking the rois uniformly until they fit (false: no layout fits)
+    bool pack(CCRecord& ccRcd, cv::Mat& frame) {
+        std::vector<CCZone>& ccZones = ccRcd.ccZones;
+        std::vector<int> order(ccZones.size());
+        std::iota(order.begin(), order.end(), 0);
+
+        for (CCZone& ccZone : ccZones)
+            initRoi(ccZone, frame);
+
+        std::sort(order.begin(), order.end(), [&ccZones](int a, int b) {
+            return ccZones[a].roiScaledSize.height > ccZones[b].roiScaledSize.height;
+        });
+
+        // a single zone always fits at scale 1
+        std::vector<cv::Rect> rects;
+        bool fitAll = false;
+        for (double scale = 1.0; !fitAll && scale >= CC_PACK_MIN_SCALE; scale *= 0.9) {
+            SkylinePacker packer;
+            rects.assign(ccZones.size(), cv::Rect());
+            packer.init(NET_WIDTH_CC + CC_PACK_GAP, NET_HEIGHT_CC + CC_PACK_GAP);
+
+            fitAll = true;
+            for (int z : order) {
+                cv::Size size(ccZones[z].roiScaledSize.width * scale, ccZones[z].roiScaledSize.height * scale);
+                cv::Rect rect;
+
+                if (size.width <= 0 || size.height <= 0)
+                    continue;
+
+                if (!packer.insert(size + cv::Size(CC_PACK_GAP, CC_PACK_GAP), rect)) {
+                    fitAll = false;
+                    break;
+                }
+
+                rects[z] = cv::Rect(rect.tl(), size);
+            }
+        }
+
+        if (!fitAll)
+            return false;  // the rects of the last attempt are partial: keep none of them
+
+        canvas = cv::Mat::zeros(NET_HEIGHT_CC, NET_WIDTH_CC, CV_8UC3);
+        for (int z = 0; z < (int)ccZones.size(); z++)
+            if (!rects[z].empty())
+                placeCanvas(ccZones[z], canvas, rects[z]);
+
+        return true;
+    }
+
+    /// one canvas per zone with the roi at the origin (the zones did not fit in one canvas)
+    void placeEach(CCRecord& ccRcd, cv::Mat& frame) {
+        canvas.release();
+
+        for (CCZone& ccZone : ccRcd.ccZones) {
+            initRoi(ccZone, frame);
+            if (ccZone.roiScaledSize.width <= 0 || ccZone.roiScaledSize.height <= 0)
+                continue;
+
+            cv::Mat zoneCanvas = cv::Mat::zeros(NET_HEIGHT_CC, NET_WIDTH_CC, CV_8UC3);
+            placeCanvas(ccZone, zoneCanvas, cv::Rect(cv::Point(0, 0), ccZone.roiScaledSize));
+        }
+    }
+
+    /// compute the roi of the zone (inside the frame) and its size when scaled to the cc canvas
+    static void initRoi(CCZone& ccZone, cv::Mat& frame) {
+        ccZone.sH = (float)NET_HEIGHT_CC / frame.rows;
+        ccZone.sW = (float)NET_WIDTH_CC / frame.cols;
+
+        ccZone.roiTL = cv::Point(INT_MAX, INT_MAX);
+        ccZone.roiBR = cv::Point(0, 0);
+
+        for (auto& pt : ccZone.pts) {
+            ccZone.roiTL.x = std::min(ccZone.roiTL.x, pt.x);
+            ccZone.roiTL.y = std::min(ccZone.roiTL.y, pt.y);
+            ccZone.roiBR.x = std::max(ccZone.roiBR.x, pt.x);
+            ccZone.roiBR.y = std::max(ccZone.roiBR.y, pt.y);
+        }
+
+        // cut the roi to the frame: fill reads every row and column of it (a zone outside the frame gets no canvas)
+        cv::Rect roi;
+        if (!ccZone.pts.empty())
+            roi = cv::Rect(ccZone.roiTL, ccZone.roiBR) & cv::Rect(0, 0, frame.cols, frame.rows);
+        ccZone.roiTL = roi.tl();
+        ccZone.roiBR = roi.br();
+
+        ccZone.roiScaledSize.height = (ccZone.roiBR.y - ccZone.roiTL.y) * ccZone.sH;
+        ccZone.roiScaledSize.width = (ccZone.roiBR.x - ccZone.roiTL.x) * ccZone.sW;
+    }
+
+    /// bind the zone to rect of a (possibly shared) canvas; the roi is scaled to rect.size() (call initRoi first)
+    void placeCanvas(CCZone& ccZone, cv::Mat& zoneCanvas, cv::Rect rect) {
+        double kW = ccZone.roiScaledSize.width > 0 ? ccZone.sW * rect.width / ccZone.roiScaledSize.width : ccZone.sW;
+        double kH = ccZone.roiScaledSize.height > 0 ? ccZone.sH * rect.height / ccZone.roiScaledSize.height : ccZone.sH;
+
+        std::vector<cv::Point> movedPts;
+        for (auto& pt : ccZone.pts)
+            movedPts.emplace_back((pt.x - ccZone.roiTL.x) * kW, (pt.y - ccZone.roiTL.y) * kH);
+
+        ccZone.canvas = zoneCanvas;
+        ccZone.roiScaledSize = rect.size();
+        ccZone.roiCanvas = zoneCanvas(rect);
+        ccZone.mask = cv::Mat::zeros(rect.height, rect.width, CV_8UC3);  // dense mask of the CrowdCounter
+        cv::fillConvexPoly(ccZone.mask, movedPts, cv::Scalar(1, 1, 1));
+
+        CCZoneRemap& remap = remaps[ccZone.ccZoneID];
+        remap.rect = rect;
+        initRemap(ccZone, remap, movedPts);
+    }
+
+    /// build the remap table(same sampling positions as cv::resize with INTER_LINEAR) and the row spans of the polygon
+    static void initRemap(CCZone& ccZone, CCZoneRemap& remap, std::vector<cv::Point>& movedPts) {
+        const int cn = 3;
+        const int one = 1 << 11;
+        int srcW = ccZone.roiBR.x - ccZone.roiTL.x, srcH = ccZone.roiBR.y - ccZone.roiTL.y;
+        int dstW = remap.rect.width, dstH = remap.rect.height;
+
+        auto sample = [](int d, double scale, int srcLen, int& s0, int& s1, short& w) {
+            double f = (d + 0.5) * scale - 0.5;
+            int s = (int)std::floor(f);
+            f -= s;
+
+            if (s < 0) {
+                s = 0;
+                f = 0;
+            }
+            if (s >= srcLen - 1) {
+                s = srcLen - 1;
+                f = 0;
+            }
+
+            s0 = s;
+            s1 = std::min(s + 1, srcLen - 1);
+            w = (short)cvRound(f * one);
+        };
+
+        remap.xOfs.resize(2 * dstW);
+        remap.xWeights.resize(dstW);
+        for (int dx = 0; dx < dstW; dx++) {
+            int s0, s1;
+            sample(dx, (double)srcW / dstW, srcW, s0, s1, remap.xWeights[dx]);
+            remap.xOfs[2 * dx] = (ccZone.roiTL.x + s0) * cn;
+            remap.xOfs[2 * dx + 1] = (ccZone.roiTL.x + s1) * cn;
+        }
+
+        remap.yRows.resize(2 * dstH);
+        remap.yWeights.resize(dstH);
+        for (int dy = 0; dy < dstH; dy++) {
+            int s0, s1;
+            sample(dy, (double)srcH / dstH, srcH, s0, s1, remap.yWeights[dy]);
+            remap.yRows[2 * dy] = ccZone.roiTL.y + s0;
+            remap.yRows[2 * dy + 1] = ccZone.roiTL.y + s1;
+        }
+
+        cv::Mat spanMask = cv::Mat::zeros(dstH, dstW, CV_8UC1);
+        cv::fillConvexPoly(spanMask, movedPts, cv::Scalar(1));
+
+        remap.spans.assign(dstH, cv::Vec2i(0, 0));
+        for (int dy = 0; dy < dstH; dy++) {
+            const uchar* m = spanMask.ptr<uchar>(dy);
+            int xStart = 0, xEnd = dstW;
+
+            while (xStart < dstW && !m[xStart])
+                xStart++;
+            while (xEnd > xStart && !m[xEnd - 1])
+                xEnd--;
+
+            remap.spans[dy] = cv::Vec2i(xStart, xEnd);
+        }
+    }
+
+    /// crop, resize(bilinear) and mask the roi in one pass, directly into roiCanvas
+    static void fill(CCZone& ccZone, const CCZoneRemap& remap, cv::Mat& frame) {
+        const int cn = 3;
+        const int shift = 11;  /// fixed-point bits of the interpolation weights
+        const int one = 1 << shift;
+        const int delta = 1 << (2 * shift - 1);
+
+        for (int dy = 0; dy < ccZone.roiCanvas.rows; dy++) {
+            int xStart = remap.spans[dy][0], xEnd = remap.spans[dy][1];
+            if (xStart >= xEnd)
+                continue;
+
+            const uchar* r0 = frame.ptr<uchar>(remap.yRows[2 * dy]);
+            const uchar* r1 = frame.ptr<uchar>(remap.yRows[2 * dy + 1]);
+            int by = remap.yWeights[dy], ay = one - by;
+            uchar* dst = ccZone.roiCanvas.ptr<uchar>(dy);
+
+            for (int dx = xStart; dx < xEnd; dx++) {
+                int x0 = remap.xOfs[2 * dx], x1 = remap.xOfs[2 * dx + 1];
+                int bx = remap.xWeights[dx], ax = one - bx;
+
+                for (int c = 0; c < cn; c++) {
+                    int top = r0[x0 + c] * ax + r0[x1 + c] * bx;
+                    int bottom = r1[x0 + c] * ax + r1[x1 + c] * bx;
+                    dst[dx * cn + c] = (uchar)((top * ay + bottom * by + delta) >> (2 * shift));
+                }
+            }
+        }
+    }
+
+    cv::Mat canvas;                               /// canvas shared by all ccZones (packed)
+    bool packed = false;                          /// the last layout is packed
+    bool laidOut = false;                         /// a layout was computed
+    size_t layoutKey = 0;                         /// hash of the frame size and zone geometry of the layout
+    std::unordered_map<int, CCZoneRemap> remaps;  /// remap tables of the ccZones, keyed by ccZoneID
+};
+#endif
@@ -25,11 +25,24 @@
 
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/eventfd.h>
+#include <unistd.h>
 #endif
 
 #include "global.h"
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
 #include <opencv2/core.hpp>
 
 //get dll info
@@ -39,12 +52,26 @@ GENERATOR_API bool getDLLInfo(std::string& _device, int& _versionX10, bool& _tes
 GENERATOR_API bool parseConfigAPI(Config& cfg, std::vector<CInfo>& cInfos, const char* cfgFilename);
 
 /** @brief Initialize model
+ *
+ * With _GENERATOR_EXT (generator_mock), independent models (od, ir, fd, par, cc, sr) are loaded in parallel when
+ * cfg.parallelLoad is set, optimized engines are kept in cfg.engineCacheDir (keyed by the hash of the model file and
+ * the device) and each model runs cfg.warmupRuns inferences on a dummy input. bin/libgenerator*.so ignores these
+ * fields: with it, the client runs the cfg.warmupRuns warm-up inferences itself after initModel (see main.cpp).
  *
  * @param cfg configuration struct
  * @return initialization result(true: success, false: fail)
  */
 GENERATOR_API bool initModel(Config& cfg);
 
+#ifdef _GENERATOR_EXT
+/** @brief Get the load report of the last initModel (backend extension: generator_mock only)
+ *
+ * @param infos return one entry per loaded model
+ * @return flag for the result(true: success, false: no model loaded)
+ */
+GENERATOR_API bool getModelLoadInfo(std::vector<ModelLoadInfo>& infos);
+#endif
+
 /** @brief Run detection and PAR models for a single frame
  *
  * @param dboxes return detected dboxes of the vchID channel
@@ -70,13 +97,448 @@ GENERATOR_API bool runModelFD(FDRecord& fdRcd, cv::Mat& frame, int vchID, int& d
 
 /** @brief Run crowd counter for a single frame
  *
- * @param density return the density of people
+ * @param density return the density of people (when it is already allocated with the output size and type, e.g. the
+ *                density of the previous frame, it is written in place without an allocation)
  * @param frame input frame
  * @param vchID vchID of the input frame
  * @return flag for the running result(true: success, false: fail)
  */
 GENERATOR_API bool runModelCC(cv::Mat& density, CCRecord& ccRcd, cv::Mat& frame, int vchID);
 
+/** @brief Run detection and PAR models for a single frame into a caller-owned buffer
+ *
+ * Same as runModel, but the dboxes are written into the caller's buffer, whose size is the capacity. Keep one buffer
+ * per channel (e.g. MAX_NUM_DBOXES elements) and reuse it for every frame.
+ * Only generator_mock (_GENERATOR_EXT) fills the buffer directly without allocating. With bin/libgenerator*.so it is
+ * a client-side adapter over runModel: the backend fills a thread-local vector of the adapter (and allocates inside as
+ * it does for runModel), then the dboxes are copied to the buffer, so the call costs as much as runModel plus the copy.
+ *
+ * @param dboxes caller-owned buffer for the detected dboxes of the vchID channel
+ * @return number of detected dboxes (> dboxes.size(): overflow, only the first dboxes.size() are written and
+ *         counted), -1: fail
+ */
+#ifdef _GENERATOR_EXT
+GENERATOR_API int runModel(std::span<DetBox> dboxes, int& filteredObjCnt, CInfo& cInfo, cv::Mat& frame, int vchID,
+    uint frameCnt, float odScoreTh);
+#else
+inline int runModel(std::span<DetBox> dboxes, int& filteredObjCnt, CInfo& cInfo, cv::Mat& frame, int vchID,
+    uint frameCnt, float odScoreTh) {
+    thread_local std::vector<DetBox> results;
+
+    results.clear();
+    if (!runModel(results, filteredObjCnt, cInfo, frame, vchID, frameCnt, odScoreTh))
+        return -1;
+
+    std::copy_n(results.begin(), std::min(results.size(), dboxes.size()), dboxes.begin());
+    return (int)results.size();
+}
+#endif
+
+/** @brief Get the sub-stage timings of the last inference call on the calling thread
+ *
+ * The record is thread-local and kept per model. For submitModel* the inference runs on an InferPool worker thread:
+ * call this from the completion callback to get the record of that inference.
+ * Backend extension: only generator_mock (_GENERATOR_EXT) records stage timings, and its stages are simulated (fixed
+ * shares of the latencies of MockParams), so they exercise the reporting but do not profile a real backend.
+ * bin/libgenerator*.so keeps none: the client can only time the whole call.
+ *
+ * @param model INFER_OD, INFER_FD or INFER_CC
+ * @param timings return the timings of the last runModel, runModelFD or runModelCC call
+ * @return flag for the result(true: success, false: no call of the model on this thread, or no stage timings)
+ */
+#ifdef _GENERATOR_EXT
+GENERATOR_API bool getLastStageTimings(int model, StageTimings& timings);
+#else
+inline bool getLastStageTimings(int /*model*/, StageTimings& /*timings*/) {
+    return false;  // bin/libgenerator*.so keeps no stage timings
+}
+#endif
+
+/** @brief FrameView entry points
+ *
+ * Same as runModel, runModelFD and runModelCC, but the frame is a non-owning FrameView (pointer, stride, size and
+ * pixel format). BGR views (including crops of a larger frame) are passed to the models without a copy. NV12/I420
+ * views are converted to BGR once per frame: the conversion is reused by the following calls on the same thread when
+ * the view has the same planes and a non-zero seq. For a cropped view, dboxes are in the coordinates of the crop.
+ */
+inline cv::Mat viewToBGR(const FrameView& view) {
+    thread_local cv::Mat buf;
+    thread_local const uchar* lastPlane = nullptr;
+    thread_local uint64_t lastSeq = 0;
+
+    if (view.pixFmt == PIX_FMT_BGR)
+        return view.toBGR(buf);
+
+    if (view.seq == 0 || view.seq != lastSeq || view.planes[0] != lastPlane || buf.cols != view.width ||
+        buf.rows != view.height) {
+        view.toBGR(buf);
+        lastPlane = view.planes[0];
+        lastSeq = view.seq;
+    }
+
+    return buf;
+}
+
+inline bool runModel(std::vector<DetBox>& dboxes, int& filteredObjCnt, CInfo& cInfo, const FrameView& view, int vchID,
+    uint frameCnt, float odScoreTh) {
+    cv::Mat frame = viewToBGR(view);
+    return runModel(dboxes, filteredObjCnt, cInfo, frame, vchID, frameCnt, odScoreTh);
+}
+
+inline bool runModelFD(FDRecord& fdRcd, const FrameView& view, int vchID, int& detectedClassID) {
+    cv::Mat frame = viewToBGR(view);
+    return runModelFD(fdRcd, frame, vchID, detectedClassID);
+}
+
+inline bool runModelCC(cv::Mat& density, CCRecord& ccRcd, const FrameView& view, int vchID) {
+    cv::Mat frame = viewToBGR(view);
+    return runModelCC(density, ccRcd, frame, vchID);
+}
+
+/// ticket of an asynchronous inference (0: invalid)
+typedef uint64_t InferTicket;
+
+/// completion callback of an asynchronous inference
+/// called on the worker thread of the inference after the outputs are written and just before the ticket becomes
+/// done, so pollModel/waitModel callers also see everything the callback wrote
+typedef void (*InferCallback)(InferTicket ticket, bool result, void* userData);
+
+#define INFER_WORKERS 1  /// default number of worker threads behind submitModel* (see setInferWorkers)
+
+/** @brief Worker pool behind submitModel* (client side)
+ *
+ * The backend only exports the blocking runModel, runModelFD and runModelCC; the asynchronous API runs them on a few
+ * client threads. Work is sharded by vchID, so the calls of a channel run in submission order on one worker and never
+ * concurrently. With more than one worker, different channels run concurrently (see the thread-safety contract below).
+ */
+class InferPool {
+   public:
+    static InferPool& get() {
+        static InferPool pool;
+        return pool;
+    }
+
+    ~InferPool() {
+        stop();
+    }
+
+    /// finish the queued work and use numWorkers threads from the next submit
+    void setWorkers(int _numWorkers) {
+        stop();
+        numWorkers = std::max(_numWorkers, 1);
+    }
+
+    InferTicket submit(int shard, std::function<bool()> work, InferCallback callback, void* userData) {
+        InferTicket ticket = nextTicket++;
+        {
+            std::lock_guard<std::mutex> lock(ticketMutex);
+            tickets[ticket] = TicketState{false, false};
+        }
+
+        // setWorkers/stop replace the workers under startMutex: keep it until the job is queued
+        std::lock_guard<std::mutex> startLock(startMutex);
+        startWorkers();
+
+        Worker& worker = *workers[shard % workers.size()];
+        {
+            std::lock_guard<std::mutex> lock(worker.m);
+            worker.jobs.push_back(Job{ticket, std::move(work), callback, userData});
+        }
+        worker.cv.notify_one();
+
+        return ticket;
+    }
+
+    int poll(InferTicket ticket, bool& result) {
+        std::lock_guard<std::mutex> lock(ticketMutex);
+        auto it = tickets.find(ticket);
+
+        if (it == tickets.end())
+            return -1;
+        if (!it->second.done)
+            return 0;
+
+        result = it->second.result;
+        tickets.erase(it);
+        return 1;
+    }
+
+    bool wait(InferTicket ticket, bool& result, int timeoutMs) {
+        std::unique_lock<std::mutex> lock(ticketMutex);
+        auto isDone = [&]() {
+            auto it = tickets.find(ticket);
+            return it == tickets.end() || it->second.done;
+        };
+
+        if (timeoutMs < 0)
+            ticketCv.wait(lock, isDone);
+        else if (!ticketCv.wait_for(lock, std::chrono::milliseconds(timeoutMs), isDone))
+            return false;
+
+        auto it = tickets.find(ticket);
+        if (it == tickets.end())
+            return false;
+
+        result = it->second.result;
+        tickets.erase(it);
+        return true;
+    }
+
+    int completionFD() {
+        std::lock_guard<std::mutex> lock(startMutex);
+        startWorkers();
+        return eventFD;
+    }
+
+    /// finish the queued work and join the workers
+    void stop() {
+        std::lock_guard<std::mutex> startLock(startMutex);
+
+        for (auto& worker : workers) {
+            {
+                std::lock_guard<std::mutex> lock(worker->m);
+                worker->stopping = true;
+            }
+            worker->cv.notify_one();
+        }
+
+        for (auto& worker : workers)
+            worker->th.join();
+
+        workers.clear();
+
+#ifndef _WIN32
+        if (eventFD >= 0)
+            ::close(eventFD);
+#endif
+        eventFD = -1;
+    }
+
+   private:
+    struct Job {
+        InferTicket ticket;
+        std::function<bool()> work;
+        InferCallback callback;
+        void* userData;
+    };
+
+    struct Worker {
+        std::thread th;
+        std::mutex m;
+        std::condition_variable cv;
+        std::deque<Job> jobs;
+        bool stopping = false;
+    };
+
+    struct TicketState {
+        bool done;
+        bool result;
+    };
+
+    /// start the workers unless they are running (call with startMutex held)
+    void startWorkers() {
+        if (!workers.empty())
+            return;
+
+#ifndef _WIN32
+        eventFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
+
+        for (int w = 0; w < numWorkers; w++) {
+            workers.push_back(std::make_unique<Worker>());
+            Worker* worker = workers.back().get();
+            worker->th = std::thread([this, worker]() { run(*worker); });
+        }
+    }
+
+    void run(Worker& worker) {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(worker.m);
+                worker.cv.wait(lock, [&]() { return worker.stopping || !worker.jobs.empty(); });
+
+                if (worker.jobs.empty())
+                    return;
+
+                job = std::move(worker.jobs.front());
+                worker.jobs.pop_front();
+            }
+
+            bool result = job.work();
+
+            if (job.callback)
+                job.callback(job.ticket, result, job.userData);
+
+            {
+                std::lock_guard<std::mutex> lock(ticketMutex);
+                tickets[job.ticket] = TicketState{true, result};
+            }
+            ticketCv.notify_all();
+
+#ifndef _WIN32
+            if (eventFD >= 0) {
+                uint64_t one = 1;
+                ssize_t written = ::write(eventFD, &one, sizeof(one));
+                (void)written;
+            }
+#endif
+        }
+    }
+
+    int numWorkers = INFER_WORKERS;
+    std::mutex startMutex;
+    std::vector<std::unique_ptr<Worker>> workers;
+    int eventFD = -1;
+
+    std::atomic<InferTicket> nextTicket{1};
+    std::mutex ticketMutex;
+    std::condition_variable ticketCv;
+    std::unordered_map<InferTicket, TicketState> tickets;
+};
+
+/** @brief Asynchronous inference
+ *
+ * submitModel, submitModelFD and submitModelCC queue a call of runModel, runModelFD or runModelCC on the client worker
+ * pool (InferPool) and return immediately. All arguments are caller-owned and must stay alive and untouched until
+ * the ticket is done; results are written into them (dboxes, filteredObjCnt, records, density, ...).
+ * Work for the same vchID (OD, FD and CC) runs one after another in submission order; different channels run in
+ * parallel only with more than one worker (see setInferWorkers).
+ * A done ticket is released by pollModel or waitModel, which should be called exactly once per ticket. Wait for all
+ * tickets before destroyModel.
+ *
+ * @param callback optional completion callback (keep it short: it runs on a worker thread)
+ * @param userData passed to callback
+ * @return ticket of the inference (0: the inference could not be queued)
+ */
+inline InferTicket submitModel(std::vector<DetBox>& dboxes, int& filteredObjCnt, CInfo& cInfo, cv::Mat& frame,
+    int vchID, uint frameCnt, float odScoreTh, InferCallback callback = nullptr, void* userData = nullptr) {
+    return InferPool::get().submit(
+        vchID,
+        [&dboxes, &filteredObjCnt, &cInfo, &frame, vchID, frameCnt, odScoreTh]() {
+            return runModel(dboxes, filteredObjCnt, cInfo, frame, vchID, frameCnt, odScoreTh);
+        },
+        callback, userData);
+}
+
+/// caller-owned buffer version of submitModel: numBoxes returns the value of runModel(std::span<DetBox>, ...)
+inline InferTicket submitModel(std::span<DetBox> dboxes, int& numBoxes, int& filteredObjCnt, CInfo& cInfo,
+    cv::Mat& frame, int vchID, uint frameCnt, float odScoreTh, InferCallback callback = nullptr,
+    void* userData = nullptr) {
+    return InferPool::get().submit(
+        vchID,
+        [dboxes, &numBoxes, &filteredObjCnt, &cInfo, &frame, vchID, frameCnt, odScoreTh]() {
+            numBoxes = runModel(dboxes, filteredObjCnt, cInfo, frame, vchID, frameCnt, odScoreTh);
+            return numBoxes >= 0;
+        },
+        callback, userData);
+}
+
+inline InferTicket submitModelFD(FDRecord& fdRcd, cv::Mat& frame, int vchID, int& detectedClassID,
+    InferCallback callback = nullptr, void* userData = nullptr) {
+    return InferPool::get().submit(
+        vchID,
+        [&fdRcd, &frame, vchID, &detectedClassID]() { return runModelFD(fdRcd, frame, vchID, detectedClassID); },
+        callback, userData);
+}
+
+inline InferTicket submitModelCC(cv::Mat& density, CCRecord& ccRcd, cv::Mat& frame, int vchID,
+    InferCallback callback = nullptr, void* userData = nullptr) {
+    return InferPool::get().submit(
+        vchID,
+        [&density, &ccRcd, &frame, vchID]() { return runModelCC(density, ccRcd, frame, vchID); }, callback, userData);
+}
+
+/** @brief Check an asynchronous inference without blocking
+ *
+ * @param ticket ticket returned by submitModel*
+ * @param result return the result of the inference (valid when done)
+ * @return 1: done (the ticket is released), 0: pending, -1: unknown ticket
+ */
+inline int pollModel(InferTicket ticket, bool& result) {
+    return InferPool::get().poll(ticket, result);
+}
+
+/** @brief Wait for an asynchronous inference
+ *
+ * @param ticket ticket returned by submitModel*
+ * @param result return the result of the inference
+ * @param timeoutMs maximum waiting time (-1: infinite)
+ * @return flag for completion(true: done and released, false: timeout or unknown ticket)
+ */
+inline bool waitModel(InferTicket ticket, bool& result, int timeoutMs = -1) {
+    return InferPool::get().wait(ticket, result, timeoutMs);
+}
+
+/** @brief Get the completion eventfd (Linux)
+ *
+ * @return eventfd incremented by one for every completed ticket (-1: not supported); can be used in poll/epoll loops
+ */
+inline int getCompletionFD() {
+    return InferPool::get().completionFD();
+}
+
+/** @brief Set the number of worker threads behind submitModel* (default: INFER_WORKERS)
+ *
+ * Waits for the queued work; the new workers start with the next submit.
+ * More than one worker calls the backend concurrently for different vchIDs: only with a backend that allows it (see the
+ * thread-safety contract below).
+ */
+inline void setInferWorkers(int numWorkers) {
+    InferPool::get().setWorkers(numWorkers);
+}
+
+/** @brief Thread-safety contract
+ *
+ *  - initModel and destroyModel must not run concurrently with any other call.
+ *  - runModel, runModelFD and runModelCC never run concurrently for the same vchID (the records of a channel and the
+ *    per-channel state of the backend are not locked). The asynchronous API follows this: all submissions of a vchID
+ *    run one after another in submission order.
+ *  - Concurrent calls for different vchIDs are only supported by generator_mock (_GENERATOR_EXT). The vendor library
+ *    (bin/libgenerator*.so) does not document it, so keep its calls serialized (one thread, or INFER_WORKERS 1).
+ *  - The records passed to a call (CInfo, FDRecord, CCRecord) belong to one vchID and must not be shared between
+ *    concurrent calls.
+ */
+
+#ifdef _GENERATOR_EXT
+/** @brief Inference contexts (backend extension: only implemented by generator_mock, see _GENERATOR_EXT)
+ *
+ * A context is a handle bound to the models loaded by initModel (weights are shared, not copied) that owns the
+ * per-call scratch state. Create one per channel (vchID >= 0) or one per worker thread (vchID = -1: any channel).
+ *  - Destroy all contexts before destroyModel.
+ *  - Calls on different contexts may run concurrently from any threads.
+ *  - A context must not be used by two threads at the same time (calls on it are not locked).
+ *  - The context-free runModel, runModelFD and runModelCC behave like calls on an implicit context of the given
+ *    vchID.
+ */
+typedef struct InferContextImpl* InferContext;
+
+/** @brief Create an inference context (after initModel)
+ *
+ * @param vchID channel served by the context (-1: any channel)
+ * @return context handle (nullptr: fail)
+ */
+GENERATOR_API InferContext createContext(int vchID);
+
+/** @brief Destroy an inference context
+ *
+ * @param ctx context created by createContext
+ * @return flag for the destruction result(true: success, false: fail)
+ */
+GENERATOR_API bool destroyContext(InferContext ctx);
+
+/// runModel, runModelFD and runModelCC on an inference context (false also when vchID is not served by ctx)
+GENERATOR_API bool runModel(InferContext ctx, std::vector<DetBox>& dboxes, int& filteredObjCnt, CInfo& cInfo,
+    cv::Mat& frame, int vchID, uint frameCnt, float odScoreTh);
+
+GENERATOR_API int runModel(InferContext ctx, std::span<DetBox> dboxes, int& filteredObjCnt, CInfo& cInfo,
+    cv::Mat& frame, int vchID, uint frameCnt, float odScoreTh);
+
+GENERATOR_API bool runModelFD(InferContext ctx, FDRecord& fdRcd, cv::Mat& frame, int vchID, int& detectedClassID);
+
+GENERATOR_API bool runModelCC(InferContext ctx, cv::Mat& density, CCRecord& ccRcd, cv::Mat& frame, int vchID);
+#endif
+
 /** @brief Destroy all models
  *
  * @param None
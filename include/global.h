@@ -4,6 +4,9 @@
 =============================================================================*/
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <string>
@@ -19,6 +22,7 @@
 
 /// System
 #define OD_ID_PERSON 0  /// person should be the first object in a mapping list
+#define MAX_NUM_DBOXES 1024  /// capacity of the per-channel dbox buffers (see runModel with std::span)
 
 #ifndef _CPU_INFER
 #define NET_WIDTH_OD 1920   /// net width for od and od-ir
@@ -33,6 +37,12 @@
 #define OD_MODE_RGB 1
 #define OD_MODE_IR 2
 
+/// INFER_MODEL (models of runModel, runModelFD and runModelCC)
+#define INFER_OD 0
+#define INFER_FD 1
+#define INFER_CC 2
+#define NUM_INFER_MODELS 3
+
 #define NET_WIDTH_FD 640   /// net width for fd
 #define NET_HEIGHT_FD 360  /// net height for fd
 
@@ -77,6 +87,11 @@
 #define SUPER_EYE_DISABLE 0
 #define SUPER_EYE_ENABLE 1
 
+/// PIX_FMT (pixel formats of FrameView)
+#define PIX_FMT_BGR 0   /// packed 8-bit BGR (same layout as CV_8UC3)
+#define PIX_FMT_NV12 1  /// Y plane + interleaved UV plane (4:2:0)
+#define PIX_FMT_I420 2  /// Y, U and V planes (4:2:0)
+
 typedef unsigned char uchar;
 typedef unsigned int uint;
 
@@ -199,7 +214,7 @@ struct CCZone {
             if (pt.x > roiBR.x)
                 roiBR.x = pt.x;
 
-            if (pt.y > roiTL.y)
+            if (pt.y > roiBR.y)
                 roiBR.y = pt.y;
         }
 
@@ -396,6 +411,92 @@ struct DetBox {
     PedAtts patts;  /// PAR info
 };
 
+/// non-owning view of a frame in caller memory (decoder output, a crop of a larger frame, ...)
+struct FrameView {
+    uchar* planes[3];   /// plane pointers (BGR: packed pixels, NV12: Y and UV, I420: Y, U and V)
+    size_t strides[3];  /// bytes per row of each plane
+    int width;          /// width of the frame (in pixels)
+    int height;         /// height of the frame (in pixels)
+    int pixFmt;         /// PIX_FMT_BGR, PIX_FMT_NV12 or PIX_FMT_I420
+    uint64_t seq;       /// content sequence number set by the producer (0: unknown, conversions are not reused)
+
+    static FrameView fromBGR(uchar* data, size_t stride, int width, int height, uint64_t seq = 0) {
+        return FrameView{{data, nullptr, nullptr}, {stride, 0, 0}, width, height, PIX_FMT_BGR, seq};
+    }
+
+    static FrameView fromMat(cv::Mat& mat, uint64_t seq = 0) {
+        CV_Assert(mat.type() == CV_8UC3);
+        return fromBGR(mat.data, mat.step[0], mat.cols, mat.rows, seq);
+    }
+
+    static FrameView fromNV12(uchar* y, size_t yStride, uchar* uv, size_t uvStride, int width, int height,
+        uint64_t seq = 0) {
+        return FrameView{{y, uv, nullptr}, {yStride, uvStride, 0}, width, height, PIX_FMT_NV12, seq};
+    }
+
+    static FrameView fromI420(uchar* y, size_t yStride, uchar* u, size_t uStride, uchar* v, size_t vStride, int width,
+        int height, uint64_t seq = 0) {
+        return FrameView{{y, u, v}, {yStride, uStride, vStride}, width, height, PIX_FMT_I420, seq};
+    }
+
+    /// zero-copy sub-view (for 4:2:0 formats the rect is aligned down/up to even coordinates)
+    FrameView crop(cv::Rect rect) const {
+        rect &= cv::Rect(0, 0, width, height);
+        FrameView v = *this;
+
+        if (pixFmt == PIX_FMT_BGR) {
+            v.planes[0] = planes[0] + rect.y * strides[0] + rect.x * 3;
+        }
+        else {
+            int x0 = rect.x & ~1, y0 = rect.y & ~1;
+            rect = cv::Rect(x0, y0, (rect.x + rect.width - x0 + 1) & ~1, (rect.y + rect.height - y0 + 1) & ~1) &
+                cv::Rect(0, 0, width, height);
+
+            v.planes[0] = planes[0] + rect.y * strides[0] + rect.x;
+            if (pixFmt == PIX_FMT_NV12) {
+                v.planes[1] = planes[1] + rect.y / 2 * strides[1] + rect.x;
+            }
+            else {
+                v.planes[1] = planes[1] + rect.y / 2 * strides[1] + rect.x / 2;
+                v.planes[2] = planes[2] + rect.y / 2 * strides[2] + rect.x / 2;
+            }
+        }
+
+        v.width = rect.width;
+        v.height = rect.height;
+        return v;
+    }
+
+    /// BGR Mat of the view: a zero-copy header for PIX_FMT_BGR, otherwise converted into buf
+    cv::Mat toBGR(cv::Mat& buf) const {
+        if (pixFmt == PIX_FMT_BGR)
+            return cv::Mat(height, width, CV_8UC3, planes[0], strides[0]);
+
+        cv::Mat y(height, width, CV_8UC1, planes[0], strides[0]);
+
+        if (pixFmt == PIX_FMT_NV12) {
+            cv::Mat uv(height / 2, width / 2, CV_8UC2, planes[1], strides[1]);
+            cv::cvtColorTwoPlane(y, uv, buf, cv::COLOR_YUV2BGR_NV12);
+            return buf;
+        }
+
+        // I420 is converted from one contiguous (height * 3 / 2) x width buffer
+        thread_local cv::Mat packed;
+        packed.create(height * 3 / 2, width, CV_8UC1);
+        y.copyTo(packed.rowRange(0, height));
+
+        uchar* dstU = packed.ptr<uchar>(height);
+        uchar* dstV = dstU + (width / 2) * (height / 2);
+        for (int r = 0; r < height / 2; r++) {
+            memcpy(dstU + r * (width / 2), planes[1] + r * strides[1], width / 2);
+            memcpy(dstV + r * (width / 2), planes[2] + r * strides[2], width / 2);
+        }
+
+        cv::cvtColor(packed, buf, cv::COLOR_YUV2BGR_I420);
+        return buf;
+    }
+};
+
 struct Config {
     std::string key;                       /// authorization Key
     uint frameLimit;                       /// number of frames to be processed
@@ -483,4 +584,109 @@ struct Config {
     std::string ccModelFile;  /// crowd counting model file
     int ccWindowSize;
     int ccPeriod;  /// fire detection period
-};
\ No newline at end of file
+
+    // model loading (parallelLoad and engineCacheDir: initModel of generator_mock only, see _GENERATOR_EXT)
+    bool parallelLoad = true;    /// load independent models in parallel
+    std::string engineCacheDir;  /// persistent engine/calibration cache directory (empty: disabled)
+    int warmupRuns = 2;          /// warm-up inferences per model after initModel (0: disabled, see main)
+
+    // OD scheduling (client side, see MotionGate, BoxPredictor and OdRoi)
+    std::vector<int> motionGateChannels;  /// 1: skip OD on static frames of the channel (empty: no gating)
+    float motionGateTh = 0.002f;          /// fraction of moving pixels in the gated area that triggers OD
+    int motionGateMaxSkip = 15;           /// OD runs at least once every motionGateMaxSkip frames
+    int odPeriod = 1;                     /// OD runs on one of odPeriod frames of a channel
+    int predictMaxFrames = 30;            /// frames a track is extrapolated after its last detection
+    std::vector<int> odRoiChannels;       /// 1: run OD on the bounding box of the zones and counting lines only
+    int odRoiPadding = 64;                /// padding(px) around the zones and counting lines of the OD crop
+
+    // input health (client side, see VideoStreamer)
+    bool dupDetection = false;   /// hash every frame and skip OD/CC on exact duplicates of the previous frame
+    float frozenFrameTh = 3.0f;  /// largest block-mean luma difference of an unchanged frame (gray levels)
+    int frozenSec = 10;          /// unchanged frames for this long (stream time) raise STREAM_EVENT_FROZEN (0: never)
+
+    // event clips (client side, see EventRecorder)
+    // the pre-roll JPEG-encodes every frame of every channel on the loop thread (several ms per 1080p frame at
+    // clipJpegQuality 80): budget it like an extra draw stage
+    bool eventRecording = false;             /// record clips around events (independent of recording)
+    std::string clipDir = "outputs/clips/";  /// directory of the clips
+    float clipPreSec = 5.0f;                 /// pre-roll kept in memory (seconds)
+    float clipPostSec = 5.0f;                /// post-roll after the last trigger of a clip (seconds)
+    float clipMaxSec = 60.0f;                /// longest clip (seconds)
+    int clipMaxConcurrent = 2;               /// clips collecting or waiting for the writer at the same time
+    float clipMaxMBps = 20.0f;               /// disk bandwidth of the clip writer (MB/s of JPEG frames, 0: unlimited)
+    int clipJpegQuality = 80;                /// JPEG quality of the pre-roll frames
+
+    // result log (client side, see ResultLogWriter)
+    bool resultLog = false;                        /// append the results of every frame to a binary log per channel
+    std::string resultLogDir = "outputs/results/";  /// directory of the logs (ch<vchID>.irl)
+
+    // metrics (client side, see Metrics)
+    int metricsPort = 0;                            /// Prometheus endpoint on 127.0.0.1:<port>/metrics (0: disabled)
+    std::string metricsDumpFile = "metrics.prom";  /// periodic dump of the same text
+    int metricsDumpSec = 0;                         /// period of the dumps (0: disabled)
+
+    // FD/CC scheduling (client side, see InferScheduler)
+    bool adaptiveSchedule = false;  /// run FD and CC by scene activity (false: every frame, periods of the backend)
+    int inferBudget = 0;            /// FD and CC inferences per second over all channels (0: unlimited)
+    float fdSceneChangeTh = 6.0f;   /// mean gray level change since the last FD that triggers FD (0: disable)
+    int ccMaxPeriod = 30;           /// longest CC period (frames) while the counts are stable
+};
+
+/// data structure for the load report of a model (see getModelLoadInfo)
+struct ModelLoadInfo {
+    std::string name;  /// od, ir, fd, par, cc or sr
+    std::string file;  /// model file
+    bool cacheHit;     /// the optimized engine was loaded from engineCacheDir (false: built from the model file)
+    int loadMs;        /// load or build time(ms)
+    int warmupMs;      /// time of the warm-up runs(ms)
+};
+
+/// data structure for the sub-stage timings of one runModel, runModelFD or runModelCC call (generator_mock only, see
+/// getLastStageTimings)
+/// stages that do not apply to the model are 0
+struct StageTimings {
+    int model;     /// INFER_OD, INFER_FD or INFER_CC
+    int vchID;     /// vchID of the call
+    int preUs;     /// preprocessing: resize to the net input, normalization (us)
+    int inferUs;   /// network inference (us)
+    int nmsUs;     /// od: score filtering and NMS (us)
+    int trackUs;   /// od: tracking and counting (us)
+    int parUs;     /// od: PAR on the crops of the tracked boxes (us)
+    int postUs;    /// fd: temporal smoothing, cc: density post-processing (us)
+
+    int numBoxesPreNms;   /// od: candidate boxes before NMS
+    int numBoxesPostNms;  /// od: boxes after NMS and filtering
+    int numParCrops;      /// od: crops run through PAR (see attUpdatePeriod)
+    int numParBatches;    /// od: PAR batches (see parBatchSize)
+};
+
+#define CACHE_LINE_SIZE 64  /// destructive interference size of the target CPUs
+
+/// data structure for the per-channel hot state
+/// Config stays the source of truth; ChannelState keeps a copy of the per-frame flags of one vchID. main processes the
+/// channels on one thread: the cache-line alignment only matters once channels run on threads of their own (see
+/// bench/channelstate_bench.cpp), and costs less than a line per channel.
+struct alignas(CACHE_LINE_SIZE) ChannelState {
+    int vchID;
+    int odMode;         /// OD mode of the channel (OD_MODE_NONE, OD_MODE_RGB, OD_MODE_IR)
+    bool fdOn;          /// fire detection enabled for the channel
+    bool ccOn;          /// crowd counting enabled for the channel
+    bool motionGateOn;  /// OD gated by motion (see MotionGate)
+    int odPeriod;       /// OD runs on one of odPeriod frames (staggered by vchID)
+    uint frameCnt;      /// number of frames processed in the channel
+
+    /// copy the channel config (call again whenever cfg is updated, e.g. after VideoStreamer::init)
+    void init(const Config& cfg, int _vchID) {
+        auto at = [_vchID](const auto& vec, auto def) { return _vchID < (int)vec.size() ? vec[_vchID] : def; };
+
+        vchID = _vchID;
+        odMode = at(cfg.odChannels, OD_MODE_NONE);
+        fdOn = at(cfg.fdChannels, 0) != 0;
+        ccOn = at(cfg.ccChannels, 0) != 0;
+        motionGateOn = at(cfg.motionGateChannels, 0) != 0;
+        odPeriod = std::max(cfg.odPeriod, 1);
+        frameCnt = 0;
+    }
+};
+
+static_assert(sizeof(ChannelState) % CACHE_LINE_SIZE == 0, "ChannelState should fill whole cache lines");
\ No newline at end of file
@@ -0,0 +1,145 @@
+/*==============================================================================
+* Copyright 2024 AIPro Inc.
+* Author: Chun-Su Park (cspk@skku.edu)
+=============================================================================*/
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <mutex>
+
+#include "generator.h"
+
+/// @brief a small executor that lets coroutines co_await submitModel* tickets
+/// Coroutines are resumed only on the threads that call InferLoop::run/runOne (never on InferPool worker threads),
+/// so a few client threads can drive many channels, e.g.
+///
+///     InferTask channelLoop(InferLoop& loop, ...) {
+///         while (streamer.read(frame, vchID)) {
+///             bool ok = co_await loop.submit([&](InferCallback cb, void* ud) {
+///                 return submitModel(dboxes, filteredObjCnt, cInfo, frame, vchID, frameCnt, odScoreTh, cb, ud);
+///             });
+///             ...
+///         }
+///     }
+class InferLoop {
+   public:
+    /// awaiter over one submitModel* call; co_await returns the inference result
+    template <typename Submit>
+    struct Awaiter {
+        InferLoop& loop;
+        Submit submitFn;
+        std::coroutine_handle<> handle;
+        InferTicket ticket = 0;
+        bool result = false;
+
+        bool await_ready() {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> h) {
+            handle = h;
+
+            // nothing in *this may be touched after a successful submit: the callback can resume the coroutine first
+            Submit fn = std::move(submitFn);
+            InferLoop& l = loop;
+            if (fn(&Awaiter::onDone, this) == 0)
+                l.post(h);
+        }
+
+        bool await_resume() {
+            if (ticket != 0)
+                waitModel(ticket, result);  // the callback runs just before the ticket is done: release it
+
+            return result;
+        }
+
+        static void onDone(InferTicket t, bool, void* userData) {
+            Awaiter* self = (Awaiter*)userData;
+            self->ticket = t;
+            self->loop.post(self->handle);
+        }
+    };
+
+    /// submitFn(InferCallback, void*) should call one of submitModel* with the given callback and userData
+    template <typename Submit>
+    Awaiter<Submit> submit(Submit submitFn) {
+        return Awaiter<Submit>{*this, std::move(submitFn), {}, 0, false};
+    }
+
+    /// schedule a coroutine to be resumed by run/runOne
+    void post(std::coroutine_handle<> h) {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            ready.push_back(h);
+        }
+        cv.notify_one();
+    }
+
+    /// resume one ready coroutine (false: timeout or stopped)
+    bool runOne(int timeoutMs = -1) {
+        std::coroutine_handle<> h;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            auto hasWork = [&]() { return stopped || !ready.empty(); };
+
+            if (timeoutMs < 0)
+                cv.wait(lock, hasWork);
+            else if (!cv.wait_for(lock, std::chrono::milliseconds(timeoutMs), hasWork))
+                return false;
+
+            if (ready.empty())
+                return false;
+
+            h = ready.front();
+            ready.pop_front();
+        }
+
+        h.resume();
+        return true;
+    }
+
+    /// resume coroutines until stop is called (can be called from several threads)
+    void run() {
+        while (runOne())
+            ;
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(m);
+            stopped = true;
+        }
+        cv.notify_all();
+    }
+
+   private:
+    std::mutex m;
+    std::condition_variable cv;
+    std::deque<std::coroutine_handle<>> ready;
+    bool stopped = false;
+};
+
+/// @brief fire-and-forget coroutine type for channel loops driven by InferLoop
+/// The coroutine starts on the calling thread and is destroyed when it finishes.
+struct InferTask {
+    struct promise_type {
+        InferTask get_return_object() {
+            return {};
+        }
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+        void return_void() {
+        }
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+};
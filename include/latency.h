@@ -0,0 +1,202 @@
+/*==============================================================================
+* Copyright 2024 AIPro Inc.
+* Author: Chun-Su Park (cspk@skku.edu)
+=============================================================================*/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/// LAT_STAGE (stages of a frame recorded in LatencyTable)
+#define LAT_CAPTURE 0  /// streamer.read
+#define LAT_OD 1       /// runModel
+#define LAT_FD 2       /// runModelFD
+#define LAT_CC 3       /// runModelCC
+#define LAT_DRAW 4     /// drawing the results
+#define LAT_ENCODE 5   /// streamer.write
+#define LAT_E2E 6      /// from capture to encode
+#define NUM_LAT_STAGES 7
+
+inline const char* latStageName(int stage) {
+    static const char* names[NUM_LAT_STAGES] = {"capture", "od", "fd", "cc", "draw", "encode", "e2e"};
+    return (stage >= 0 && stage < NUM_LAT_STAGES) ? names[stage] : "?";
+}
+
+/// @brief log-bucketed (HDR-style) latency histogram in us with constant memory
+/// Values below 64us are exact; above, each power of two is split into 32 buckets (relative error < 3.2%).
+/// Values are clamped to 2^32us (about 71 minutes). Not thread-safe: use one histogram per recording thread and merge.
+class LatencyHistogram {
+   public:
+    static constexpr int SUB_BITS = 5;
+    static constexpr int SUB_COUNT = 1 << SUB_BITS;
+    static constexpr int MAX_BITS = 32;
+    static constexpr int NUM_BUCKETS = 2 * SUB_COUNT + (MAX_BITS - SUB_BITS - 1) * SUB_COUNT;
+
+    void record(int64_t us) {
+        uint64_t v = (uint64_t)std::clamp<int64_t>(us, 0, ((int64_t)1 << MAX_BITS) - 1);
+
+        counts[index(v)]++;
+        count++;
+        sum += v;
+        minUs = std::min(minUs, v);
+        maxUs = std::max(maxUs, v);
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < NUM_BUCKETS; i++)
+            counts[i] += other.counts[i];
+
+        count += other.count;
+        sum += other.sum;
+        minUs = std::min(minUs, other.minUs);
+        maxUs = std::max(maxUs, other.maxUs);
+    }
+
+    void reset() {
+        *this = LatencyHistogram();
+    }
+
+    /// value at quantile q (0 - 1): upper bound of the bucket holding the q-th value (capped by the max)
+    int64_t percentile(double q) const {
+        if (count == 0)
+            return 0;
+
+        uint64_t rank = std::max<uint64_t>((uint64_t)(q * count + 0.5), 1);
+        uint64_t acc = 0;
+        for (int i = 0; i < NUM_BUCKETS; i++) {
+            acc += counts[i];
+            if (acc >= rank)
+                return (int64_t)std::min(upperBound(i), maxUs);
+        }
+
+        return (int64_t)maxUs;
+    }
+
+    uint64_t getCount() const {
+        return count;
+    }
+
+    double getMean() const {
+        return count > 0 ? (double)sum / count : 0.0;
+    }
+
+    int64_t getMin() const {
+        return count > 0 ? (int64_t)minUs : 0;
+    }
+
+    int64_t getMax() const {
+        return (int64_t)maxUs;
+    }
+
+   private:
+    static int index(uint64_t v) {
+        if (v < 2 * SUB_COUNT)
+            return (int)v;
+
+        int msb = 63 - std::countl_zero(v);
+        int shift = msb - SUB_BITS;
+        return 2 * SUB_COUNT + (shift - 1) * SUB_COUNT + (int)(v >> shift) - SUB_COUNT;
+    }
+
+    static uint64_t upperBound(int idx) {
+        if (idx < 2 * SUB_COUNT)
+            return (uint64_t)idx;
+
+        int shift = (idx - 2 * SUB_COUNT) / SUB_COUNT + 1;
+        uint64_t sub = (uint64_t)((idx - 2 * SUB_COUNT) % SUB_COUNT + SUB_COUNT);
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::array<uint64_t, NUM_BUCKETS> counts{};
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t minUs = UINT64_MAX;
+    uint64_t maxUs = 0;
+};
+
+/// @brief latency histograms per channel x stage with text reports and CSV snapshots
+class LatencyTable {
+   public:
+    void init(int numChannels) {
+        hists.assign(numChannels, {});
+        csvStarted = false;
+    }
+
+    void record(int vchID, int stage, int64_t us) {
+        hists[vchID][stage].record(us);
+    }
+
+    /// merged histogram of a stage over all channels
+    LatencyHistogram merged(int stage) const {
+        LatencyHistogram h;
+        for (auto& chHists : hists)
+            h.merge(chHists[stage]);
+        return h;
+    }
+
+    /// print p50/p90/p99/p999/max(ms) of each stage (all channels, then each channel when perChannel is set)
+    void print(std::ostream& os, bool perChannel = false) const {
+        os << std::format("{:<10}{:>10}{:>9}{:>9}{:>9}{:>9}{:>9}{:>9}\n", "stage", "count", "mean", "p50", "p90",
+            "p99", "p999", "max");
+
+        for (int stage = 0; stage < NUM_LAT_STAGES; stage++)
+            printRow(os, latStageName(stage), merged(stage));
+
+        if (!perChannel)
+            return;
+
+        for (int vchID = 0; vchID < (int)hists.size(); vchID++)
+            for (int stage = 0; stage < NUM_LAT_STAGES; stage++)
+                printRow(os, std::format("[{}]{}", vchID, latStageName(stage)), hists[vchID][stage]);
+    }
+
+    /// append one CSV row per channel x stage (vchID -1: all channels) with the cumulative percentiles(us)
+    /// the first dump of a run truncates the file, so it never mixes rows of earlier runs
+    bool dumpCSV(const std::string& filename, double elapsedSec) {
+        std::ofstream out(filename, csvStarted ? std::ios::app : std::ios::trunc);
+        if (!out)
+            return false;
+
+        if (!csvStarted)
+            out << "elapsed_sec,vch_id,stage,count,mean_us,p50_us,p90_us,p99_us,p999_us,max_us\n";
+        csvStarted = true;
+
+        for (int stage = 0; stage < NUM_LAT_STAGES; stage++)
+            writeCSV(out, elapsedSec, -1, stage, merged(stage));
+
+        for (int vchID = 0; vchID < (int)hists.size(); vchID++)
+            for (int stage = 0; stage < NUM_LAT_STAGES; stage++)
+                writeCSV(out, elapsedSec, vchID, stage, hists[vchID][stage]);
+
+        return true;
+    }
+
+   private:
+    static void printRow(std::ostream& os, const std::string& name, const LatencyHistogram& h) {
+        if (h.getCount() == 0)
+            return;
+
+        os << std::format("{:<10}{:>10}{:>9.2f}{:>9.2f}{:>9.2f}{:>9.2f}{:>9.2f}{:>9.2f}\n", name, h.getCount(),
+            h.getMean() / 1000.0, h.percentile(0.5) / 1000.0, h.percentile(0.9) / 1000.0, h.percentile(0.99) / 1000.0,
+            h.percentile(0.999) / 1000.0, h.getMax() / 1000.0);
+    }
+
+    static void writeCSV(std::ofstream& out, double elapsedSec, int vchID, int stage, const LatencyHistogram& h) {
+        if (h.getCount() == 0)
+            return;
+
+        out << std::format("{:.1f},{},{},{},{:.1f},{},{},{},{},{}\n", elapsedSec, vchID, latStageName(stage),
+            h.getCount(), h.getMean(), h.percentile(0.5), h.percentile(0.9), h.percentile(0.99), h.percentile(0.999),
+            h.getMax());
+    }
+
+    std::vector<std::array<LatencyHistogram, NUM_LAT_STAGES>> hists;
+    bool csvStarted = false;  /// dumpCSV wrote the header of this run
+};
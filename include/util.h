@@ -302,40 +302,53 @@ class Vis {
 // `docs\[hahv]_setup_preprocessor definition.md` for more details.
 class PPrint {
    public:
-    static unordered_map<string, int> colorToIntMap() {
-        return {
+    // the tables are built once (not on every call)
+    static const unordered_map<string, int>& colorToIntMap() {
+        static const unordered_map<string, int> m = {
             {"black", 0},  {"dark_blue", 1},  {"dark_green", 2}, {"light_blue", 3}, {"dark_red", 4}, {"magenta", 5},
             {"orange", 6}, {"light_gray", 7}, {"gray", 8},       {"blue", 9},       {"green", 10},   {"cyan", 11},
             {"red", 12},   {"pink", 13},      {"yellow", 14},    {"white", 15}  // default
         };
+        return m;
     }
 
-    static unordered_map<string, string> textColorMap() {
-        return {{"black", "30"},    {"dark_blue", "34"}, {"dark_green", "32"}, {"light_blue", "36"},
-                {"dark_red", "31"}, {"magenta", "35"},   {"orange", "33"},     {"light_gray", "37"},
-                {"gray", "90"},     {"blue", "94"},      {"green", "92"},      {"cyan", "96"},
-                {"red", "91"},      {"pink", "95"},      {"yellow", "93"},     {"white", "97"}};
+    static const unordered_map<string, string>& textColorMap() {
+        static const unordered_map<string, string> m = {
+            {"black", "30"},    {"dark_blue", "34"}, {"dark_green", "32"}, {"light_blue", "36"},
+            {"dark_red", "31"}, {"magenta", "35"},   {"orange", "33"},     {"light_gray", "37"},
+            {"gray", "90"},     {"blue", "94"},      {"green", "92"},      {"cyan", "96"},
+            {"red", "91"},      {"pink", "95"},      {"yellow", "93"},     {"white", "97"}};
+        return m;
     }
 
-    static unordered_map<string, string> bgColorMap() {
-        return {{"black", "40"},    {"dark_blue", "44"}, {"dark_green", "42"}, {"light_blue", "46"},
-                {"dark_red", "41"}, {"magenta", "45"},   {"orange", "43"},     {"light_gray", "47"},
-                {"gray", "100"},    {"blue", "104"},     {"green", "102"},     {"cyan", "106"},
-                {"red", "101"},     {"pink", "105"},     {"yellow", "103"},    {"white", "107"}};
+    static const unordered_map<string, string>& bgColorMap() {
+        static const unordered_map<string, string> m = {
+            {"black", "40"},    {"dark_blue", "44"}, {"dark_green", "42"}, {"light_blue", "46"},
+            {"dark_red", "41"}, {"magenta", "45"},   {"orange", "43"},     {"light_gray", "47"},
+            {"gray", "100"},    {"blue", "104"},     {"green", "102"},     {"cyan", "106"},
+            {"red", "101"},     {"pink", "105"},     {"yellow", "103"},    {"white", "107"}};
+        return m;
     }
 
-    static string getColoredText(string textcolor) {
-        string text_color_code = textColorMap()[textcolor];
-        return "\033[" + textColorMap()[textcolor] + "m";
+    /// value of key in m (def: unknown color)
+    template <typename T>
+    static T lookup(const unordered_map<string, T>& m, const string& key, T def) {
+        auto it = m.find(key);
+        return it != m.end() ? it->second : def;
     }
-    static string getColoredText(string textColor, string bgColor) {
-        return "\033[" + textColorMap()[textColor] + ";" + bgColorMap()[bgColor] + "m";
+
+    static string getColoredText(const string& textColor) {
+        return "\033[" + lookup(textColorMap(), textColor, string()) + "m";
+    }
+    static string getColoredText(const string& textColor, const string& bgColor) {
+        return "\033[" + lookup(textColorMap(), textColor, string()) + ";" + lookup(bgColorMap(), bgColor, string()) +
+               "m";
     }
 
     static void enableColor(string textColor) {
 #if defined(_WIN32)
         static const HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
-        int textColorInt = colorToIntMap()[textColor];
+        int textColorInt = lookup(colorToIntMap(), textColor, 0);
         SetConsoleTextAttribute(handle, textColorInt);
 #else
         cout << getColoredText(textColor);
@@ -344,8 +357,8 @@ class PPrint {
     static void enableColor(string textColor, string bgColor) {
 #if defined(_WIN32)
         static const HANDLE handle = GetStdHandle(STD_OUTPUT_HANDLE);
-        int textColorInt = colorToIntMap()[textColor];
-        int bgColorInt = colorToIntMap()[bgColor];
+        int textColorInt = lookup(colorToIntMap(), textColor, 0);
+        int bgColorInt = lookup(colorToIntMap(), bgColor, 0);
         int colorAttribute = textColorInt + bgColorInt * 16;
         SetConsoleTextAttribute(handle, colorAttribute);
 #else
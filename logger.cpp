@@ -0,0 +1,199 @@
+#include "logger.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "util.h"
+
+using namespace std;
+using namespace std::chrono;
+
+#define NUM_LOG_KEYS 256  /// rate limit slots per category (keys are folded into this range)
+
+namespace {
+
+struct LogNode {
+    atomic<LogNode*> next{nullptr};
+    int cat;
+    string text;
+};
+
+struct LogLimit {
+    int64_t minIntervalUs = 0;
+    int sampleEvery = 1;
+};
+
+struct LogState {
+    // intrusive MPSC queue (D. Vyukov): producers exchange head, the writer thread owns tail
+    atomic<LogNode*> head;
+    LogNode* tail;
+    LogNode stub;
+
+    LogLimit limits[NUM_LOG_CATS];
+    atomic<int64_t> lastUs[NUM_LOG_CATS][NUM_LOG_KEYS];
+    atomic<uint64_t> seen[NUM_LOG_CATS][NUM_LOG_KEYS];
+    atomic<uint64_t> suppressed[NUM_LOG_CATS];
+
+    thread writer;
+    atomic<bool> running{false};
+
+    LogState() : head(&stub), tail(&stub) {
+        for (int c = 0; c < NUM_LOG_CATS; c++) {
+            for (int k = 0; k < NUM_LOG_KEYS; k++) {
+                lastUs[c][k] = INT64_MIN / 2;
+                seen[c][k] = 0;
+            }
+            suppressed[c] = 0;
+        }
+    }
+};
+
+LogState& state() {
+    static LogState s;
+    return s;
+}
+
+const char* catColors[NUM_LOG_CATS] = {"white", "yellow", "", "red"};
+
+void enqueue(LogState& s, LogNode* node) {
+    node->next.store(nullptr, memory_order_relaxed);
+    LogNode* prev = s.head.exchange(node, memory_order_acq_rel);
+    prev->next.store(node, memory_order_release);
+}
+
+/// pop the oldest node (nullptr: empty, or a producer is between its exchange and its link)
+LogNode* dequeue(LogState& s) {
+    LogNode* tail = s.tail;
+    LogNode* next = tail->next.load(memory_order_acquire);
+
+    if (tail == &s.stub) {
+        if (!next)
+            return nullptr;
+
+        s.tail = next;
+        tail = next;
+        next = next->next.load(memory_order_acquire);
+    }
+
+    if (next) {
+        s.tail = next;
+        return tail;
+    }
+
+    if (tail != s.head.load(memory_order_acquire))
+        return nullptr;
+
+    enqueue(s, &s.stub);
+    next = tail->next.load(memory_order_acquire);
+    if (next) {
+        s.tail = next;
+        return tail;
+    }
+
+    return nullptr;
+}
+
+void writeLine(int cat, const string& text) {
+#ifdef _COLORED_LOG
+    if (catColors[cat][0] != '\0') {
+        PPrint::print(text, catColors[cat]);
+        return;
+    }
+#endif
+    cout << text;
+}
+
+/// write all queued lines (writer thread, or the caller of stop after the join)
+bool drain(LogState& s) {
+    bool any = false;
+
+    while (LogNode* node = dequeue(s)) {
+        writeLine(node->cat, node->text);
+        delete node;
+        any = true;
+    }
+
+    if (any)
+        cout.flush();
+
+    return any;
+}
+
+}  // namespace
+
+void Logger::start() {
+    LogState& s = state();
+    if (s.running.exchange(true))
+        return;
+
+    s.writer = thread([&s]() {
+        while (s.running.load(memory_order_acquire)) {
+            if (!drain(s))
+                this_thread::sleep_for(milliseconds(2));
+        }
+    });
+}
+
+void Logger::stop() {
+    LogState& s = state();
+    if (!s.running.exchange(false))
+        return;
+
+    s.writer.join();
+    drain(s);
+}
+
+void Logger::setRateLimit(int cat, int minIntervalMs, int sampleEvery) {
+    if (cat < 0 || cat >= NUM_LOG_CATS)
+        return;
+
+    LogLimit& limit = state().limits[cat];
+    limit.minIntervalUs = (int64_t)minIntervalMs * 1000;
+    limit.sampleEvery = std::max(sampleEvery, 1);
+}
+
+bool Logger::admit(int cat, int key) {
+    LogState& s = state();
+    const LogLimit& limit = s.limits[cat];
+    int k = key < 0 ? 0 : key % NUM_LOG_KEYS;
+
+    if (limit.sampleEvery > 1 && s.seen[cat][k].fetch_add(1, memory_order_relaxed) % limit.sampleEvery != 0) {
+        s.suppressed[cat].fetch_add(1, memory_order_relaxed);
+        return false;
+    }
+
+    if (limit.minIntervalUs > 0) {
+        int64_t now = duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+        int64_t last = s.lastUs[cat][k].load(memory_order_relaxed);
+
+        if (now - last < limit.minIntervalUs ||
+            !s.lastUs[cat][k].compare_exchange_strong(last, now, memory_order_relaxed)) {
+            s.suppressed[cat].fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void Logger::push(int cat, std::string text) {
+    if (text.empty() || text.back() != '\n')
+        text += '\n';
+
+    LogState& s = state();
+    if (!s.running.load(memory_order_acquire)) {
+        writeLine(cat, text);
+        return;
+    }
+
+    LogNode* node = new LogNode;
+    node->cat = cat;
+    node->text = std::move(text);
+    enqueue(s, node);
+}
+
+uint64_t Logger::getSuppressed(int cat) {
+    return (cat >= 0 && cat < NUM_LOG_CATS) ? state().suppressed[cat].load() : 0;
+}
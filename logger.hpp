@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <format>
+#include <string>
+
+/// LOG_CAT (categories of Logger; each has its own rate limit and color)
+#define LOG_CAT_INFO 0   /// start-up, shutdown and reports
+#define LOG_CAT_WARN 1   /// recoverable problems (e.g. dbox buffer overflow)
+#define LOG_CAT_FRAME 2  /// per-frame summaries
+#define LOG_CAT_EVENT 3  /// fire, crowd and counting events
+#define NUM_LOG_CATS 4
+
+/// @brief asynchronous console logger
+/// Producers push formatted lines into a lock-free MPSC queue that a background thread drains and writes to cout, so
+/// the calling (inference) threads never block on the console. Each category can be rate limited per key (e.g. vchID:
+/// at most one line per channel per interval) and sampled (one line in N); rejected lines are never formatted.
+/// Without start (or after stop), lines are written synchronously.
+class Logger {
+   public:
+    /// start the writer thread
+    static void start();
+
+    /// write the queued lines and stop the writer thread (call when no other thread logs anymore)
+    static void stop();
+
+    /// limit a category: at most one line per key every minIntervalMs (0: no limit), and keep one of sampleEvery
+    /// lines (1: all); call before start
+    static void setRateLimit(int cat, int minIntervalMs, int sampleEvery = 1);
+
+    /// check the rate limit and sampling of (cat, key) for one line (key: e.g. vchID, -1: none)
+    static bool admit(int cat, int key);
+
+    /// queue a line (a trailing newline is added when missing)
+    static void push(int cat, std::string text);
+
+    /// number of lines rejected by the rate limit or sampling of a category
+    static uint64_t getSuppressed(int cat);
+};
+
+/// format and queue a line only when it passes the rate limit of (cat, key)
+#define LOG_MSG(cat, key, ...)                                 \
+    do {                                                       \
+        if (Logger::admit(cat, key))                           \
+            Logger::push(cat, std::format(__VA_ARGS__));       \
+    } while (0)
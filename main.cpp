@@ -8,6 +8,8 @@
 #include <filesystem>
 #include <format>
 #include <chrono>
+#include <span>
+#include <sstream>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -18,31 +20,124 @@
 #include <opencv2/core/core.hpp>
 
 // core
+#include "cccanvas.h"
+#include "draw.hpp"
 #include "global.h"
 #include "generator.h"
+#include "latency.h"
+#include "logger.hpp"
+#include "metrics.hpp"
+#include "motion.hpp"
+#include "predictor.hpp"
+#include "recorder.hpp"
+#include "resultlog.hpp"
+#include "roi.hpp"
+#include "scheduler.hpp"
+#include "trace.hpp"
 #include "videostreamer.hpp"
 
 // util
 #include "util.h"
 
-#define DRAW_DETECTION_BOXES true
-#define DRAW_DETECTION_INFO true
-#define DRAW_CNTLINE true
-#define DRAW_CNTLINE_COUNTING false
-#define DRAW_ZONE true
-#define DRAW_ZONE_COUNTING false
-#define DRAW_FIRE_DETECTION true
-#define DRAW_CC true
+#define LATENCY_SKIP_FRAMES 10              // start frames of each channel excluded from the latency histograms
+#define LATENCY_SNAPSHOT_SEC 10             // period of the latency snapshots (0: disable)
+#define LATENCY_SNAPSHOT_FILE "latency.csv"  // csv file of the snapshots of the run (truncated by the first one)
+
+#define LOG_FRAME_PERIOD_MS 1000  // per-frame summary: at most one line per channel per period (0: every frame)
+#define LOG_WARN_PERIOD_MS 1000   // same warning of a channel: at most once per period
+
+#define MOTION_GATE false     // gate OD of every channel by motion (otherwise: channels of cfg.motionGateChannels)
+#define BOX_PREDICTION true   // extrapolate the tracks on frames without OD (false: reuse the dboxes of the last OD)
+#define OD_ROI false          // crop OD of every channel to its zones and counting lines (otherwise: cfg.odRoiChannels)
+#define ADAPTIVE_SCHEDULE false  // schedule FD and CC by scene activity (otherwise: cfg.adaptiveSchedule)
+#define EVENT_RECORDING false    // record clips around the events of every channel (otherwise: cfg.eventRecording)
+#define RESULT_LOG false         // binary result log of every channel (otherwise: cfg.resultLog)
+#define DUP_DETECTION false      // reuse OD/CC on duplicate frames of every channel (otherwise: cfg.dupDetection)
+
+#define METRICS_PORT 0      // Prometheus endpoint on 127.0.0.1, e.g. 9464 (otherwise: cfg.metricsPort, 0: disabled)
+#define METRICS_DUMP_SEC 0  // periodic dump of the same text to cfg.metricsDumpFile (otherwise: cfg.metricsDumpSec)
+
+#define TRACE_FILE "trace.json"  // Chrome/Perfetto trace of the window below (build with ENABLE_TRACE)
+#define TRACE_START_SEC 5        // start of the trace window after the first frame
+#define TRACE_DURATION_SEC 10    // length of the trace window
 
 using namespace std;
 using namespace cv;
 using namespace std::chrono;
 
-void drawZones(Config& cfg, ODRecord& odRcd, Mat& img, int vchID, double alpha);
-void drawBoxes(Config& cfg, ODRecord& odRcd, Mat& img, vector<DetBox>& dboxes, int vchID,
-    double alpha = 0.7);
-void drawFD(Config& cfg, FDRecord& fdRcd, Mat& img, int vchID, float fdScoreThFire, float fdScoreThSmoke);
-void drawCC(Config& cfg, CCRecord& ccRcd, Mat& density, Mat& img, int vchID);
+// live metrics of a channel (registered once, updated with relaxed atomics)
+struct ChannelMetrics {
+    MetricCounter* frames;
+    MetricCounter* failures[NUM_INFER_MODELS];  // inferences that failed
+    MetricCounter* dboxOverflows;               // frames with more dboxes than the dbox buffer
+    MetricCounter* odGated;                     // frames whose OD was skipped by the motion gate
+    MetricGauge* motion;                        // moving pixel fraction of the last gated frame
+    MetricCounter* odPredicted;                 // frames whose dboxes were extrapolated by BoxPredictor
+    MetricCounter* duplicates;                  // duplicate frames processed without OD/CC
+    MetricGauge* frozen;                        // 1 while the input is frozen (STREAM_EVENT_FROZEN)
+    MetricGauge* fdPeriod;                      // current FD period of InferScheduler (frames)
+    MetricGauge* ccPeriod;                      // current CC period of InferScheduler (frames)
+    MetricCounter* deferred;                    // due FD or CC runs that waited for the inference budget
+    MetricGauge* fps;                           // updated every second
+    MetricHistogram* latencies[NUM_INFER_MODELS];
+    MetricHistogram* e2e;
+    uint64_t lastFrames = 0;  // frames at the last fps update
+
+    void init(int vchID) {
+        static const char* models[NUM_INFER_MODELS] = {"od", "fd", "cc"};
+        static const vector<double> bounds = {0.005, 0.01, 0.02, 0.033, 0.05, 0.1, 0.2, 0.5, 1.0};  // seconds
+        string ch = std::format("vchID=\"{}\"", vchID);
+
+        frames = &Metrics::counter("inet_frames_total", "Frames processed", ch);
+        dboxOverflows = &Metrics::counter("inet_dbox_overflows_total", "Frames with more dboxes than the buffer", ch);
+        odGated = &Metrics::counter("inet_od_gated_total", "Frames whose OD was skipped by the motion gate", ch);
+        motion = &Metrics::gauge("inet_motion_ratio", "Moving pixel fraction in the gated area", ch);
+        odPredicted = &Metrics::counter("inet_od_predicted_total", "Frames whose dboxes were extrapolated", ch);
+        duplicates = &Metrics::counter("inet_duplicate_frames_total", "Duplicate frames without OD/CC", ch);
+        frozen = &Metrics::gauge("inet_stream_frozen", "1 while the input stream is frozen", ch);
+        fdPeriod = &Metrics::gauge("inet_fd_period_frames", "Current FD period of the scheduler", ch);
+        ccPeriod = &Metrics::gauge("inet_cc_period_frames", "Current CC period of the scheduler", ch);
+        deferred = &Metrics::counter("inet_sched_deferred_total", "FD or CC runs deferred by the budget", ch);
+        fps = &Metrics::gauge("inet_channel_fps", "Processed frames per second", ch);
+        e2e = &Metrics::histogram("inet_frame_seconds", "End-to-end latency of a frame", ch, bounds);
+
+        for (int m = 0; m < NUM_INFER_MODELS; m++) {
+            string labels = std::format("{},model=\"{}\"", ch, models[m]);
+            failures[m] = &Metrics::counter("inet_inference_failures_total", "Failed inferences", labels);
+            latencies[m] = &Metrics::histogram("inet_inference_seconds", "Latency of an inference", labels, bounds);
+        }
+    }
+};
+
+// running sums of StageTimings (64-bit: long runs)
+struct StageSums {
+    int64_t preUs = 0, inferUs = 0, nmsUs = 0, trackUs = 0, parUs = 0, postUs = 0;
+    int64_t numBoxesPreNms = 0, numBoxesPostNms = 0, numParCrops = 0, numParBatches = 0;
+    int64_t num = 0;
+
+    void add(const StageTimings& st) {
+        preUs += st.preUs;
+        inferUs += st.inferUs;
+        nmsUs += st.nmsUs;
+        trackUs += st.trackUs;
+        parUs += st.parUs;
+        postUs += st.postUs;
+        numBoxesPreNms += st.numBoxesPreNms;
+        numBoxesPostNms += st.numBoxesPostNms;
+        numParCrops += st.numParCrops;
+        numParBatches += st.numParBatches;
+        num++;
+    }
+
+    // average in ms
+    float avgMs(int64_t us) const {
+        return num > 0 ? us / 1000.0f / num : 0.0f;
+    }
+
+    float avg(int64_t cnt) const {
+        return num > 0 ? (float)cnt / num : 0.0f;
+    }
+};
 
 // same config file for both windows and linux
 const char* cfgFilename = "config.json";
@@ -53,6 +148,8 @@ int main() {
     Config cfg;
     vector<CInfo> cInfos;  // channel information for each vchID
 
+    InferScheduler scheduler;  // FD and CC periods of all channels under one inference budget (cfg.adaptiveSchedule)
+
     //print dll info
     string device;
     int dllVersionX10, numInfLimit;
@@ -65,10 +162,67 @@ int main() {
             cout << "parseConfigAPI: Parsing Error!\n";
             return -1;
         }
+
+        // the scheduler takes over the FD and CC periods: the backend then runs FD and CC on every call it gets
+        if (ADAPTIVE_SCHEDULE)
+            cfg.adaptiveSchedule = true;
+        if (cfg.adaptiveSchedule) {
+            scheduler.init(cfg);
+            cfg.fdPeriod = 1;
+            cfg.ccPeriod = 1;
+        }
+
+        steady_clock::time_point startInit = steady_clock::now();
         if (!initModel(cfg)) {
             cout << "initModel: Initialization of the solution failed!\n";
             return -1;
         }
+
+        int delayInit = duration_cast<milliseconds>(steady_clock::now() - startInit).count();
+#ifdef _GENERATOR_EXT
+        cout << std::format("initModel: {} ms{}\n", delayInit, cfg.parallelLoad ? " (parallel load)" : "");
+
+        vector<ModelLoadInfo> loadInfos;
+        if (getModelLoadInfo(loadInfos)) {
+            for (ModelLoadInfo& info : loadInfos)
+                cout << std::format("  {:<3}: load {:>5} ms ({}), warm-up {:>4} ms, {}\n", info.name, info.loadMs,
+                    info.cacheHit ? "cached" : "built", info.warmupMs, info.file);
+        }
+#else
+        cout << std::format("initModel: {} ms\n", delayInit);
+
+        // warm-up (generator_mock warms up in initModel): cfg.warmupRuns inferences of each model on a blank frame,
+        // on copies of the records of channel 0 so that its tracks and counts start clean
+        if (cfg.warmupRuns > 0 && !cInfos.empty()) {
+            steady_clock::time_point startWarmup = steady_clock::now();
+            Mat blank = Mat::zeros(cfg.odNetHeight, cfg.odNetWidth, CV_8UC3);
+            vector<DetBox> dboxes;
+            Mat density;
+
+            for (int r = 0; r < cfg.warmupRuns; r++) {
+                CInfo cInfo = cInfos[0];
+                int filteredObjCnt = 0, detectedClassID = -1;
+
+                if (cfg.odEnable)
+                    runModel(dboxes, filteredObjCnt, cInfo, blank, 0, r, cfg.odScoreTh);
+                if (cfg.fdEnable)
+                    runModelFD(cInfo.fdRcd, blank, 0, detectedClassID);
+#ifndef _CPU_INFER
+                if (cfg.ccEnable)
+                    runModelCC(density, cInfo.ccRcd, blank, 0);
+#else
+                if (cfg.ccEnable && cInfo.ccRcd.ccZones.size() > 0) {
+                    CCCanvas ccCanvas;
+                    ccCanvas.setCanvas(cInfo.ccRcd, blank);
+                    runModelCC(density, cInfo.ccRcd, blank, 0);
+                }
+#endif
+            }
+
+            cout << std::format("warm-up: {} ms ({} runs)\n",
+                duration_cast<milliseconds>(steady_clock::now() - startWarmup).count(), cfg.warmupRuns);
+        }
+#endif
     }
     catch (const std::exception& e) {
         cout << e.what() << endl;
@@ -77,444 +231,478 @@ int main() {
 
     VideoStreamer streamer(cfg, cInfos);
 
-    vector<unsigned int> frameCnts;
-    frameCnts.resize(cfg.numChannels, 0);
+    if (MOTION_GATE && cfg.motionGateChannels.empty())
+        cfg.motionGateChannels.assign(cfg.numChannels, 1);
+    if (OD_ROI && cfg.odRoiChannels.empty())
+        cfg.odRoiChannels.assign(cfg.numChannels, 1);
+    if (DUP_DETECTION)
+        cfg.dupDetection = true;
+    if (EVENT_RECORDING)
+        cfg.eventRecording = true;
+    if (RESULT_LOG)
+        cfg.resultLog = true;
+    if (METRICS_PORT > 0)
+        cfg.metricsPort = METRICS_PORT;
+    if (METRICS_DUMP_SEC > 0)
+        cfg.metricsDumpSec = METRICS_DUMP_SEC;
+
+    // OD crops (the od scale factors of a cropped channel follow its crop)
+    vector<OdRoi> odRois(cfg.numChannels);
+    for (int c = 0; c < cfg.numChannels && c < (int)cfg.odRoiChannels.size(); c++) {
+        if (!cfg.odRoiChannels[c] || !cfg.odEnable || !cfg.odChannels[c])
+            continue;
+
+        OdRoi& roi = odRois[c];
+        if (roi.init(cInfos[c].odRcd, c, Size(cfg.frameWidths[c], cfg.frameHeights[c]), cfg.odRoiPadding)) {
+            cfg.odScaleFactors[c] = roi.scaleFactor(cfg.odNetWidth, cfg.odNetHeight);
+            cfg.odScaleFactorsInv[c] = 1.0f / cfg.odScaleFactors[c];
+
+            const Rect& r = roi.getRect();
+            cout << std::format("[{}] OD crop: {}x{} at ({}, {}), scale {:.2f}\n", c, r.width, r.height, r.x, r.y,
+                cfg.odScaleFactors[c]);
+        }
+    }
+
+    vector<ChannelState> chStates(cfg.numChannels);  // hot per-channel state (cfg is updated by streamer)
+    for (int c = 0; c < cfg.numChannels; c++)
+        chStates[c].init(cfg, c);
+
+    vector<MotionGate> motionGates(cfg.numChannels);
+    for (int c = 0; c < cfg.numChannels; c++)
+        if (chStates[c].motionGateOn)
+            motionGates[c].init(cInfos[c].odRcd, c, cfg.motionGateTh, cfg.motionGateMaxSkip);
+
+    EventRecorder recorder;  // clips around intrusions, fires and CC level changes
+    if (cfg.eventRecording && !recorder.start(cfg))
+        cfg.eventRecording = false;
+    vector<vector<int>> ccLevels(cfg.numChannels);  // ccLevel of each CCZone at the last CC
+
+    vector<ResultLogWriter> resultLogs(cfg.numChannels);  // results of every frame (see tools/resultlog2jsonl)
+    if (cfg.resultLog) {
+        error_code ec;
+        filesystem::create_directories(cfg.resultLogDir, ec);
+        for (int c = 0; c < cfg.numChannels; c++) {
+            string file = std::format("{}ch{}.irl", cfg.resultLogDir, c);
+            if (!resultLogs[c].open(file, c, cfg.frameWidths[c], cfg.frameHeights[c], cfg.fpss[c]))
+                cout << std::format("[{}] Cannot write the result log {}\n", c, file);
+        }
+    }
+
+    vector<BoxPredictor> predictors(cfg.numChannels);
+    for (BoxPredictor& predictor : predictors)
+        predictor.init(cfg.predictMaxFrames);
+
+    // per-channel output buffers reused for every frame (the backend writes into them without allocating)
+    vector<vector<DetBox>> dboxBufs(cfg.numChannels, vector<DetBox>(MAX_NUM_DBOXES));
+    vector<int> lastNumBoxes(cfg.numChannels, 0);  // dboxes of the last OD (reused on frames without OD)
+    vector<Mat> densities(cfg.numChannels);
+#ifdef _CPU_INFER
+    vector<CCCanvas> ccCanvases(cfg.numChannels);  // one canvas for all ccZones of a channel
+#endif
+
     unsigned int frameLimit = cfg.frameLimit;  // number of frames to be processed
 
     steady_clock::time_point startAll, endAll, startOD, endOD, startFD, endFD, startCC, endCC;
-    vector<int> delayODs, delayFDs, delayCCs;
+    StageTimings timingsOD{}, timingsFD{}, timingsCC{};
+    bool hasTimingsOD = false, hasTimingsFD = false, hasTimingsCC = false;  // see getLastStageTimings
+    StageSums sumOD, sumFD, sumCC;  // sums of the stage timings (generator_mock only, same frames as the histograms)
+    uint64_t inferFailures[NUM_INFER_MODELS] = {};  // inferences that failed
+
+    vector<ChannelMetrics> chMetrics(cfg.numChannels);
+    for (int c = 0; c < cfg.numChannels; c++)
+        chMetrics[c].init(c);
+
+    if (cfg.metricsPort > 0 || cfg.metricsDumpSec > 0) {
+        if (Metrics::startServer(cfg.metricsPort, cfg.metricsDumpFile, cfg.metricsDumpSec) && cfg.metricsPort > 0)
+            cout << std::format("Metrics: http://127.0.0.1:{}/metrics\n", cfg.metricsPort);
+    }
+    steady_clock::time_point lastFpsUpdate = steady_clock::now();
+
+    LatencyTable latency;  // per channel x stage
+    latency.init(cfg.numChannels);
+    steady_clock::time_point startRun = steady_clock::now(), lastSnapshot = startRun;
+
+    // console output of the loop goes through the asynchronous logger
+    Logger::setRateLimit(LOG_CAT_FRAME, LOG_FRAME_PERIOD_MS);
+    Logger::setRateLimit(LOG_CAT_WARN, LOG_WARN_PERIOD_MS);
+    Logger::start();
+
+#ifdef _TRACE
+    bool traceWritten = false;
+    Tracer::start(TRACE_START_SEC, TRACE_DURATION_SEC);
+    Tracer::nameThread(TRACE_TID_SELF, "main");
+    Tracer::nameThread(TRACE_TID_OD, "od");
+    Tracer::nameThread(TRACE_TID_FD, "fd");
+    Tracer::nameThread(TRACE_TID_CC, "cc");
+#endif
 
     int vchID = 0;
     while (1) {
         Mat frame;
         int delayOD = 0, delayFD = 0, delayCC = 0;
 
+        steady_clock::time_point startCapture = steady_clock::now();
         if (!streamer.read(frame, vchID)) {
-            cout << "End of Videos!\n";
+            Logger::push(LOG_CAT_INFO, "End of Videos!");
             break;
         }
 
-        unsigned int& frameCnt = frameCnts[vchID];
+        ChannelState& chState = chStates[vchID];
+        ChannelMetrics& chMetric = chMetrics[vchID];
+        unsigned int& frameCnt = chState.frameCnt;
         CInfo& cInfo = cInfos[vchID];
 
         startAll = steady_clock::now();
+        int delayCapture = duration_cast<microseconds>(startAll - startCapture).count();
+        TRACE_RECORD("read", TRACE_TID_SELF, startCapture, startAll, vchID, frameCnt);
+
+        // an exact duplicate of the previous frame keeps its OD/CC results (FD still runs, so a slow fire or smoke is
+        // never hidden); a frozen input is only reported
+        bool duplicate = streamer.isDuplicate(vchID);
+        if (duplicate)
+            chMetric.duplicates->inc();
+        if (streamer.getEvent(vchID) == STREAM_EVENT_FROZEN) {
+            LOG_MSG(LOG_CAT_EVENT, vchID, "[{}]Frame{:>4}> Input frozen for {:.1f}s", vchID, frameCnt,
+                streamer.getFrozenSec(vchID));
+            chMetric.frozen->set(1);
+        }
+        else if (streamer.getEvent(vchID) == STREAM_EVENT_RECOVERED) {
+            LOG_MSG(LOG_CAT_EVENT, vchID, "[{}]Frame{:>4}> Input recovered", vchID, frameCnt);
+            chMetric.frozen->set(0);
+        }
 
         // object detection and tracking
-        vector<DetBox> dboxes;
+        vector<DetBox>& dboxBuf = dboxBufs[vchID];
+        int numBoxes = 0;
         int filteredObjsCnt = 0;  // set only when minObjs are deleted in DLL
-        if (cfg.odChannels[vchID]) {
+        bool resultOD = false, resultFD = false, resultCC = false;
+        // OD runs on one of odPeriod frames (staggered by vchID), and only on moving scenes when the channel is gated
+        bool runOD = chState.odMode != OD_MODE_NONE && (frameCnt + vchID) % chState.odPeriod == 0 && !duplicate;
+        if (runOD && chState.motionGateOn) {
+            TRACE_SPAN("motionGate", vchID, frameCnt);
+            runOD = motionGates[vchID].update(frame);
+            chMetric.motion->set(motionGates[vchID].getMotion());
+            if (!runOD)
+                chMetric.odGated->inc();
+        }
+
+        OdRoi& odRoi = odRois[vchID];
+        Mat odFrame = frame;  // crop of the frame when the channel has an OD crop (a view, no copy)
+        if (runOD) {
+            if (odRoi.enabled()) {
+                odFrame = frame(odRoi.getRect());
+                odRoi.toCrop(cInfo.odRcd);  // the backend counts in the coordinates of the frame it gets
+            }
+
             startOD = steady_clock::now();
-            runModel(dboxes, filteredObjsCnt, cInfo, frame, vchID, frameCnt, cfg.odScoreTh);
+            numBoxes = runModel(span<DetBox>(dboxBuf), filteredObjsCnt, cInfo, odFrame, vchID, frameCnt, cfg.odScoreTh);
+            resultOD = numBoxes >= 0;
             endOD = steady_clock::now();
-
+            hasTimingsOD = getLastStageTimings(INFER_OD, timingsOD);
             delayOD = duration_cast<microseconds>(endOD - startOD).count();
+            TRACE_RECORD("runModel", TRACE_TID_OD, startOD, endOD, vchID, frameCnt);
+
+            if (numBoxes > (int)dboxBuf.size()) {
+                LOG_MSG(LOG_CAT_WARN, vchID, "[{}]Frame{:>4}> {} dboxes exceed the buffer ({})", vchID, frameCnt,
+                    numBoxes, dboxBuf.size());
+                numBoxes = (int)dboxBuf.size();
+                chMetric.dboxOverflows->inc();
+            }
+        }
+
+        if (runOD && odRoi.enabled()) {
+            odRoi.toFrame(cInfo.odRcd);
+            odRoi.toFrame(span<DetBox>(dboxBuf.data(), std::clamp(numBoxes, 0, (int)dboxBuf.size())));
+        }
+
+        if (chState.odMode && !runOD) {
+            // no OD on this frame: extrapolate the tracks of the last OD, or reuse its dboxes (still in dboxBuf)
+            if (BOX_PREDICTION && !duplicate) {
+                numBoxes = predictors[vchID].predict(span<DetBox>(dboxBuf), frameCnt, frame.size());
+                chMetric.odPredicted->inc();
+            }
+            else {
+                numBoxes = lastNumBoxes[vchID];
+            }
+        }
+        lastNumBoxes[vchID] = numBoxes;
+        span<DetBox> dboxes(dboxBuf.data(), std::max(numBoxes, 0));
+
+        if (BOX_PREDICTION && resultOD)
+            predictors[vchID].correct(dboxes, frameCnt);  // snap the tracks back to the detections
+
+        // FD and CC run on every frame, or when the scheduler picks them
+        bool runFD = chState.fdOn, runCC = chState.ccOn && !duplicate;
+        if (cfg.adaptiveSchedule && (runFD || runCC)) {
+            uint64_t deferred = scheduler.getDeferred(vchID);
+            scheduler.plan(vchID, frame, runFD, runCC, runFD, runCC);
+            chMetric.deferred->inc(scheduler.getDeferred(vchID) - deferred);
         }
 
         // fire classification
         int detectedClassID = -1; // 0: FD_CLASS_FIRE, 1: FD_CLASS_NONE, 2: FD_CLASS_SMOKE 
-        if (cfg.fdChannels[vchID]) {
+        if (runFD) {
             startFD = steady_clock::now();
-            runModelFD(cInfo.fdRcd, frame, vchID, detectedClassID);
+            resultFD = runModelFD(cInfo.fdRcd, frame, vchID, detectedClassID);
             endFD = steady_clock::now();
-
+            hasTimingsFD = getLastStageTimings(INFER_FD, timingsFD);
             delayFD = duration_cast<microseconds>(endFD - startFD).count();
+            TRACE_RECORD("runModelFD", TRACE_TID_FD, startFD, endFD, vchID, frameCnt);
+            if (cfg.adaptiveSchedule && resultFD)
+                scheduler.updateFD(vchID, cInfo.fdRcd);
         }
 
         // crowd counting
-        Mat density;
-        if (cfg.ccChannels[vchID]) {
+        Mat& density = densities[vchID];
+        if (runCC) {
             startCC = steady_clock::now();
 #ifndef _CPU_INFER
-            runModelCC(density, cInfo.ccRcd, frame, vchID);
+            resultCC = runModelCC(density, cInfo.ccRcd, frame, vchID);
 #else
             if (cInfo.ccRcd.ccZones.size() > 0) {
-                cInfo.ccRcd.ccZones[0].setCanvas(frame);  // only one ccZone
-                runModelCC(density, cInfo.ccRcd, frame, vchID);
+                ccCanvases[vchID].setCanvas(cInfo.ccRcd, frame);  // all ccZones are packed into one canvas
+                resultCC = runModelCC(density, cInfo.ccRcd, frame, vchID);
             }
 #endif
             endCC = steady_clock::now();
+            hasTimingsCC = getLastStageTimings(INFER_CC, timingsCC);
             delayCC = duration_cast<microseconds>(endCC - startCC).count();
+            TRACE_RECORD("runModelCC", TRACE_TID_CC, startCC, endCC, vchID, frameCnt);
+            if (cfg.adaptiveSchedule && resultCC)
+                scheduler.updateCC(vchID, cInfo.ccRcd);
         }
 
         endAll = steady_clock::now();
 
+        int delayDraw = 0, delayEncode = 0;
         if (cfg.recording) {
-            if (cfg.odChannels[vchID] && DRAW_DETECTION_BOXES)
+            if (chState.odMode && DRAW_DETECTION_BOXES) {
+                TRACE_SPAN("drawBoxes", vchID, frameCnt);
                 drawBoxes(cfg, cInfo.odRcd, frame, dboxes, vchID);
+            }
 
-            if (cfg.fdChannels[vchID] && DRAW_FIRE_DETECTION)
+            if (chState.fdOn && DRAW_FIRE_DETECTION) {
+                TRACE_SPAN("drawFD", vchID, frameCnt);
                 drawFD(cfg, cInfo.fdRcd, frame, vchID, cfg.fdScoreThFire, cfg.fdScoreThSmoke);
+            }
 
-            if (cfg.ccChannels[vchID] && DRAW_CC)
-                drawCC(cfg, cInfo.ccRcd, density, frame, vchID);
+            if (chState.ccOn && DRAW_CC) {
+                TRACE_SPAN("drawCC", vchID, frameCnt);
+                drawCC(cfg, cInfo.ccRcd, density, frame, vchID);  // the density of the last CC on frames without CC
+            }
+
+            steady_clock::time_point startEncode = steady_clock::now();
+            delayDraw = duration_cast<microseconds>(startEncode - endAll).count();
 
             streamer.write(frame, vchID);  // write a frame to the output video
+            delayEncode = duration_cast<microseconds>(steady_clock::now() - startEncode).count();
+            TRACE_RECORD("write", TRACE_TID_SELF, startEncode, startEncode + microseconds(delayEncode), vchID, frameCnt);
         }
 
-        int delayAll = duration_cast<microseconds>(endAll - startAll).count();
-
-        //if (filteredObjsCnt > 0)
-        cout << std::format(
-            "[{}]Frame{:>4}> Infer Delay(ms): {:>4.1f} (OD: {:>4.1f}, FD: {:>3.1f}, CC: {:>4.1f}), Filtered Objs: {}\n",
-            vchID, frameCnt, delayAll / 1000.0f, delayOD / 1000.0f, delayFD / 1000.0f, delayCC / 1000.0f, filteredObjsCnt);
-
-        if (frameCnt > 10 && frameCnt < 100) {  // skip the start frames and limit the number of elements
-            if (cfg.odChannels[vchID])
-                delayODs.push_back(delayOD);
-
-            if (cfg.fdChannels[vchID])
-                delayFDs.push_back(delayFD);
+        if (cfg.eventRecording) {
+            TRACE_SPAN("eventRecorder", vchID, frameCnt);
+            auto trigger = [&](int event, const char* what) {
+                if (recorder.trigger(vchID, event, frameCnt) == 1)
+                    LOG_MSG(LOG_CAT_EVENT, vchID, "[{}]Frame{:>4}> Clip started: {}", vchID, frameCnt, what);
+            };
+
+            for (Zone& zone : cInfo.odRcd.zones)
+                if (chState.odMode && zone.enabled && zone.vchID == vchID && zone.isMode == IS_RESTRICTED_AREA &&
+                    zone.getTotal() > 0)
+                    trigger(EVENT_INTRUSION, "intrusion");
+
+            FDRecord& fdRcd = cInfo.fdRcd;
+            if (resultFD && !fdRcd.fireProbs.empty() && !fdRcd.smokeProbs.empty() &&
+                (fdRcd.fireProbs.back() >= cfg.fdScoreThFire || fdRcd.smokeProbs.back() >= cfg.fdScoreThSmoke))
+                trigger(EVENT_FIRE, "fire");
+
+            if (resultCC) {
+                vector<int>& levels = ccLevels[vchID];
+                levels.resize(cInfo.ccRcd.ccZones.size(), 0);
+                for (size_t z = 0; z < levels.size(); z++) {
+                    if (cInfo.ccRcd.ccZones[z].ccLevel != levels[z])
+                        trigger(EVENT_CC_LEVEL, "cc level");
+                    levels[z] = cInfo.ccRcd.ccZones[z].ccLevel;
+                }
+            }
 
-            if (cfg.ccChannels[vchID])
-                delayCCs.push_back(delayCC);
+            recorder.push(frame, vchID);
         }
 
-        frameCnt++;
-        if (frameLimit > 0 && frameCnt > frameLimit) {
-            cout << std::format("\nBreak loop at frameCnt={:>4} and frameLimit={:>4}\n", frameCnt, frameLimit);
-            break;
+        if (cfg.resultLog) {
+            TRACE_SPAN("resultLog", vchID, frameCnt);
+            resultLogs[vchID].append(frameCnt, dboxes, cfg.parEnable, resultFD ? &cInfo.fdRcd : nullptr,
+                resultCC ? &cInfo.ccRcd : nullptr, chState.odMode ? &cInfo.odRcd : nullptr);
         }
+        steady_clock::time_point endFrame = steady_clock::now();
 
-        vchID++;
-        if (vchID >= cfg.numChannels)
-            vchID = 0;
-    }
-
-    if (delayODs.size() > 0 || delayFDs.size() > 0 || delayCCs.size() > 0) {
-        float avgDelayOD = 0.0f, avgDelayFD = 0.0f, avgDelayCC = 0.0f;
-
-        if (delayODs.size() > 0)
-            avgDelayOD = accumulate(delayODs.begin(), delayODs.end(), 0) / delayODs.size();
-        if (delayFDs.size() > 0)
-            avgDelayFD = accumulate(delayFDs.begin(), delayFDs.end(), 0) / delayFDs.size();
-        if (delayCCs.size() > 0)
-            avgDelayCC = accumulate(delayCCs.begin(), delayCCs.end(), 0) / delayCCs.size();
-
-        float avgDelay = avgDelayOD + avgDelayFD + avgDelayCC;
-        cout << std::format("\nAverage Delay(ms): {:>.1f} (OD: {:>.1f}, FD: {:>.1f}, CC: {:>.1f})\n", avgDelay / 1000.0f, avgDelayOD / 1000.0f,
-            avgDelayFD / 1000.0f, avgDelayCC / 1000.0f);
-    }
-
-    if (cfg.recording) {
-        cout << "\nOutput file(s):\n";
-        for (auto& outFile : cfg.outputFiles)
-            cout << std::format("  -{}\n", outFile);
-    }
-
-    streamer.destroy();  // destroy streamer
-    destroyModel();      // destroy all models
-
-    cout << "\nTerminate program!\n";
-
-    return 0;
-}
+#ifdef _TRACE
+        if (!traceWritten && Tracer::finished())
+            traceWritten = Tracer::write(TRACE_FILE);
+#endif
 
-void drawZones(Config& cfg, ODRecord& odRcd, Mat& img, int vchID, double alpha) {
-    if (cfg.boostMode) {
-        int np[1] = { 4 };
-        cv::Mat layer;
+        int delayAll = duration_cast<microseconds>(endAll - startAll).count();
 
-        for (Zone& zone : odRcd.zones) {
-            if (zone.vchID == vchID) {
-                if (layer.empty())
-                    layer = img.clone();
+        // metrics
+        chMetric.frames->inc();
+        chMetric.e2e->observe(duration_cast<microseconds>(endFrame - startCapture).count() / 1e6);
 
-                int z = zone.zoneID;
-                const Scalar color(255, 50, 50);
-                fillPoly(layer, { zone.pts }, color);
+        bool modelOn[NUM_INFER_MODELS] = {runOD, runFD, runCC};
+#ifdef _CPU_INFER
+        modelOn[INFER_CC] = modelOn[INFER_CC] && cInfo.ccRcd.ccZones.size() > 0;  // no canvas to count on
+#endif
+        bool modelOk[NUM_INFER_MODELS] = {resultOD, resultFD, resultCC};
+        int modelDelays[NUM_INFER_MODELS] = {delayOD, delayFD, delayCC};
+        for (int m = 0; m < NUM_INFER_MODELS; m++) {
+            if (!modelOn[m])
+                continue;
+
+            if (modelOk[m]) {
+                chMetric.latencies[m]->observe(modelDelays[m] / 1e6);
             }
-        }
-
-        if (!layer.empty())
-            cv::addWeighted(img, alpha, layer, 1 - alpha, 0, img);
-    }
-    else {
-        for (Zone& zone : odRcd.zones) {
-            if (zone.vchID == vchID) {
-                const Scalar color(255, 20, 20);
-                polylines(img, { zone.pts }, true, color, 2);
+            else {
+                chMetric.failures[m]->inc();
+                inferFailures[m]++;
             }
         }
-    }
-}
-
-
-void drawBoxes(Config& cfg, ODRecord& odRcd, Mat& img, vector<DetBox>& dboxes, int vchID,
-    double alpha) {
-    const string* objNames = cfg.odIDMapping.data();
-    time_t now = time(NULL);
 
-    vector<Rect> boxes;
-    vector<Scalar> boxesColor;
-    vector<bool> emphasizes;
-    vector<vector<string>> boxTexts;
-    int boxCnt = 0;
-
-    for (auto& dbox : dboxes) {
-        if (dbox.objID >= cfg.numClasses)
-            continue;
-
-        int label = dbox.objID;
-        if (dbox.prob < cfg.odScoreTh)
-            continue;  // should check scores are ordered. Otherwise, use continue
-
-        boxCnt++;
-        Rect box(dbox.x, dbox.y, dbox.w, dbox.h);
-        boxes.push_back(box);
-
-        Scalar boxColor(50, 255, 255);
-        vector<string> texts;
-
-        bool isFemale;
-        int probFemale;
-
-        if (cfg.parEnable && dbox.patts.setCnt != -1) {
-            PedAtts::getGenderAtt(dbox.patts, isFemale, probFemale);
-            boxColor = isFemale ? Scalar(80, 80, 255) : Scalar(255, 80, 80);
+        if (cfg.adaptiveSchedule) {
+            chMetric.fdPeriod->set(scheduler.getFdPeriod(vchID));
+            chMetric.ccPeriod->set(scheduler.getCcPeriod(vchID));
         }
 
-        int partitionIdx = (dbox.y + dbox.h) / (img.rows / 4);  //(dbox.y + dbox.h): 0 ~ H-1
-        // boxColor = Scalar(0, 255, 0); //for hsw
-
-        if (DRAW_DETECTION_INFO) {
-            //string objName = objNames[label];
-            //string objName = objNames[label] + "(" + to_string((int)(dbox.prob * 100 + 0.5)) + "%)";
-            string objName = std::format("{}{}({:.1f}):{}({})", dbox.trackID, objNames[label], dbox.prob * 100 + 0.5, dbox.w * dbox.h, partitionIdx);
-            //string objName = std::format("{}({:.1f}):{}({})", objNames[label], dbox.prob * 100 + 0.5, dbox.w * dbox.h, partitionIdx);
-            // string objName = to_string(dbox.trackID) + objNames[label] + "(" + to_string((int)(dbox.prob * 100 +
-            // 0.5)) + "%)";
-            // string objName = to_string(dbox.trackID);
-
-            // char buf[80];
-            // tm *curTm = localtime(&dbox.inTime);
-            // strftime(buf, sizeof(buf), "Time: %H:%M:%S", curTm);
-            // string timeInfo = string(buf);
-
-            texts.push_back(objName);
-            // vector<string> texts{objName, timeInfo};
-
-            if (label == OD_ID_PERSON) {
-                //string trkInfo;
-                //int period = now - dbox.inTime;
-                //if (period < cfg.longLastingObjTh) {  // no action
-                //    trkInfo = "ET: " + to_string(period) + " (" + to_string((int)dbox.distVar) + ")";
-                //}
-                //else {                              // action (Sleep or Hang around)
-                //    if (dbox.distVar < cfg.noMoveTh)  // Sleep event
-                //        trkInfo = "ET: " + to_string(period) + ", No movement(" + to_string((int)dbox.distVar) + ")";
-                //    else  // Hang around event
-                //        trkInfo = "ET: " + to_string(period) + ", Hang around(" + to_string((int)dbox.distVar) + ")";
-                //}
-                //texts.push_back(trkInfo);
-
-                if (cfg.parEnable && dbox.patts.setCnt != -1) {
-                    string genderInfo, ageGroupInfo;
-                    int ageGroup, probAgeGroup;
-
-                    genderInfo = "Gen: " + string((isFemale ? "F" : "M")) + " (" + to_string(probFemale) + "%)" +
-                        to_string(dbox.patts.setCnt);
-                    texts.push_back(genderInfo);
-
-                    PedAtts::getAgeGroupAtt(dbox.patts, ageGroup, probAgeGroup);
-                    ageGroupInfo =
-                        "Age: " +
-                        string(ageGroup == CHILD_GROUP ? "child" : (ageGroup == ADULT_GROUP ? "adult" : "elder")) +
-                        " (" + to_string(probAgeGroup) + "%)";
-                    texts.push_back(ageGroupInfo);
-                }
+        if (endFrame - lastFpsUpdate >= seconds(1)) {
+            double sec = duration_cast<microseconds>(endFrame - lastFpsUpdate).count() / 1e6;
+            for (ChannelMetrics& cm : chMetrics) {
+                uint64_t frames = cm.frames->get();
+                cm.fps->set((frames - cm.lastFrames) / sec);
+                cm.lastFrames = frames;
             }
+            lastFpsUpdate = endFrame;
         }
 
-        boxesColor.push_back(boxColor);
-        boxTexts.push_back(texts);
-
-        if ((DRAW_CNTLINE && (dbox.justCountedLine > 0)) || (DRAW_ZONE && (dbox.justCountedZone > 0)))
-            emphasizes.push_back(true);
-        else
-            emphasizes.push_back(false);
-    }
-
-    Vis::drawBoxes(img, boxes, boxesColor, boxTexts, emphasizes);
-
-    //vector<string> boxCountText = { to_string(boxCnt) };
-    //Vis::drawTextBlock(img, Point(900, 100), boxCountText, 2, 2, Scalar(0, 0, 0), Scalar(0, 255, 0));
-
-    if (DRAW_ZONE)
-        drawZones(cfg, odRcd, img, vchID, alpha);
+        //if (filteredObjsCnt > 0)
+        LOG_MSG(LOG_CAT_FRAME, vchID,
+            "[{}]Frame{:>4}> Infer Delay(ms): {:>4.1f} (OD: {:>4.1f}, FD: {:>3.1f}, CC: {:>4.1f}), Filtered Objs: {}",
+            vchID, frameCnt, delayAll / 1000.0f, delayOD / 1000.0f, delayFD / 1000.0f, delayCC / 1000.0f, filteredObjsCnt);
 
-    // draw par results
-    if (DRAW_ZONE_COUNTING) {
-        vector<string> texts = { "People Counting for Each Zone" };
+        if (frameCnt > LATENCY_SKIP_FRAMES) {  // skip the start frames
+            latency.record(vchID, LAT_CAPTURE, delayCapture);
 
-        for (Zone& zone : odRcd.zones) {
-            int curMTotal, curFTotal;
-            curMTotal = zone.curPeople[0][0] + zone.curPeople[0][1] + zone.curPeople[0][2];
-            curFTotal = zone.curPeople[1][0] + zone.curPeople[1][1] + zone.curPeople[1][2];
+            // only successful inferences: failures are counted in inferFailures
+            if (runOD && resultOD) {
+                latency.record(vchID, LAT_OD, delayOD);
+                if (hasTimingsOD)
+                    sumOD.add(timingsOD);
+            }
 
-            string title = " Zone " + to_string(zone.zoneID);
-            string cur = "   Cur> M: " + to_string(curMTotal) + "(" + to_string(zone.curPeople[0][0]) + ", " +
-                to_string(zone.curPeople[0][1]) + ", " + to_string(zone.curPeople[0][2]) + "), " +
-                " F: " + to_string(curFTotal) + "(" + to_string(zone.curPeople[1][0]) + ", " +
-                to_string(zone.curPeople[1][1]) + ", " + to_string(zone.curPeople[1][2]) + ")";
+            if (runFD && resultFD) {
+                latency.record(vchID, LAT_FD, delayFD);
+                if (hasTimingsFD)
+                    sumFD.add(timingsFD);
+            }
 
-            int hitMTotal, hitFTotal;
-            hitMTotal = zone.hitMap[0][0] + zone.hitMap[0][1] + zone.hitMap[0][2];
-            hitFTotal = zone.hitMap[1][0] + zone.hitMap[1][1] + zone.hitMap[1][2];
+            if (runCC && resultCC) {
+                latency.record(vchID, LAT_CC, delayCC);
+                if (hasTimingsCC)
+                    sumCC.add(timingsCC);
+            }
 
-            string hit = "   Hit> M: " + to_string(hitMTotal) + "(" + to_string(zone.hitMap[0][0]) + ", " +
-                to_string(zone.hitMap[0][1]) + ", " + to_string(zone.hitMap[0][2]) + "), " +
-                " F: " + to_string(hitFTotal) + "(" + to_string(zone.hitMap[1][0]) + ", " +
-                to_string(zone.hitMap[1][1]) + ", " + to_string(zone.hitMap[1][2]) + ")";
+            if (cfg.recording) {
+                latency.record(vchID, LAT_DRAW, delayDraw);
+                latency.record(vchID, LAT_ENCODE, delayEncode);
+            }
 
-            texts.push_back(title);
-            texts.push_back(cur);
-            texts.push_back(hit);
+            latency.record(vchID, LAT_E2E, duration_cast<microseconds>(endFrame - startCapture).count());
         }
 
-        Vis::drawTextBlock(img, Point(18, 500), texts, 1, 2);
-    }
-
-    if (DRAW_CNTLINE) {
-        for (CntLine& cntLine : odRcd.cntLines) {
-            line(img, cntLine.pts[0], cntLine.pts[1], Scalar(50, 255, 50), 2, LINE_8);
+        if (LATENCY_SNAPSHOT_SEC > 0 && endFrame - lastSnapshot >= seconds(LATENCY_SNAPSHOT_SEC)) {
+            double elapsedSec = duration_cast<milliseconds>(endFrame - startRun).count() / 1000.0;
+            ostringstream snapshot;
+            snapshot << std::format("\nLatency snapshot at {:.1f}s (ms):\n", elapsedSec);
+            latency.print(snapshot);
+            Logger::push(LOG_CAT_INFO, snapshot.str());
+            latency.dumpCSV(LATENCY_SNAPSHOT_FILE, elapsedSec);
+            lastSnapshot = endFrame;
         }
-    }
 
-    // draw couniting results
-    if (DRAW_CNTLINE_COUNTING) {
-        vector<string> texts = { "People Counting for Each Line" };
-
-        for (CntLine& cntLine : odRcd.cntLines) {
-            int upMTotal, upFTotal;
-            upMTotal = cntLine.totalUL[0][0] + cntLine.totalUL[0][1] + cntLine.totalUL[0][2];
-            upFTotal = cntLine.totalUL[1][0] + cntLine.totalUL[1][1] + cntLine.totalUL[1][2];
-
-            string title = " Counting Line " + to_string(cntLine.clineID);
-            string up = "   U/L> M: " + to_string(upMTotal) + "(" + to_string(cntLine.totalUL[0][0]) + ", " +
-                to_string(cntLine.totalUL[0][1]) + ", " + to_string(cntLine.totalUL[0][2]) + "), " +
-                " F: " + to_string(upFTotal) + "(" + to_string(cntLine.totalUL[1][0]) + ", " +
-                to_string(cntLine.totalUL[1][1]) + ", " + to_string(cntLine.totalUL[1][2]) + ")";
-
-            int dwMTotal, dwFTotal;
-            dwMTotal = cntLine.totalDR[0][0] + cntLine.totalDR[0][1] + cntLine.totalDR[0][2];
-            dwFTotal = cntLine.totalDR[1][0] + cntLine.totalDR[1][1] + cntLine.totalDR[1][2];
-
-            string dw = "   D/R> M: " + to_string(dwMTotal) + "(" + to_string(cntLine.totalDR[0][0]) + ", " +
-                to_string(cntLine.totalDR[0][1]) + ", " + to_string(cntLine.totalDR[0][2]) + "), " +
-                " F: " + to_string(dwFTotal) + "(" + to_string(cntLine.totalDR[1][0]) + ", " +
-                to_string(cntLine.totalDR[1][1]) + ", " + to_string(cntLine.totalDR[1][2]) + ")";
-
-            texts.push_back(title);
-            texts.push_back(up);
-            texts.push_back(dw);
+        frameCnt++;
+        if (frameLimit > 0 && frameCnt > frameLimit) {
+            Logger::push(LOG_CAT_INFO,
+                std::format("\nBreak loop at frameCnt={:>4} and frameLimit={:>4}", frameCnt, frameLimit));
+            break;
         }
 
-        Vis::drawTextBlock(img, Point(18, 140), texts, 1, 2);
+        vchID++;
+        if (vchID >= cfg.numChannels)
+            vchID = 0;
     }
-}
-
-void drawFD(Config& cfg, FDRecord& fdRcd, Mat& img, int vchID, float fdScoreThFire, float fdScoreThSmoke) {
-    time_t now = time(NULL);
-    int h = img.rows;
-    int w = img.cols;
-    string strFire = "X", strSmoke = "X";
-
-    if (h < 500 || w < 800)
-        return;
-
-    const int fx = w - 190, fy = 290;
-    const vector<Point> ptsFire = { Point(fx + 0, fy + 54),  Point(fx + 24, fy + 0),  Point(fx + 45, fy + 48),
-                                   Point(fx + 54, fy + 21), Point(fx + 63, fy + 54), Point(fx + 54, fy + 87),
-                                   Point(fx + 15, fy + 87) };
 
-    const int sx = w - 100, sy = 290;
-    const vector<Point> ptsSmoke = { Point(sx + 0, sy + 51),  Point(sx + 0, sy + 30),  Point(sx + 21, sy + 0),
-                                    Point(sx + 21, sy + 33), Point(sx + 63, sy + 42), Point(sx + 54, sy + 60),
-                                    Point(sx + 36, sy + 87), Point(sx + 36, sy + 65) };
-
-    if (fdRcd.fireProbs.back() > fdScoreThFire) {
-        /// draw canvas
-        Mat fdIconRegion = img(Rect(Point(fx - 4, fy - 2), Point(fx + 63 + 4, fy + 87 + 2)));
-        fdIconRegion -= Scalar(100, 100, 100);
-        fillPoly(img, ptsFire, Scalar(0, 0, 255));
+    Metrics::stopServer();
+    recorder.stop();  // write the open clips
+    for (ResultLogWriter& resultLog : resultLogs)
+        resultLog.close();
+    Logger::stop();  // flush the queued lines before the reports
+    if (Logger::getSuppressed(LOG_CAT_FRAME) > 0)
+        cout << std::format("({} frame lines suppressed by the rate limit)\n", Logger::getSuppressed(LOG_CAT_FRAME));
+
+#ifdef _TRACE
+    if (!traceWritten)
+        Tracer::write(TRACE_FILE);  // the run ended within the trace window
+#endif
 
-        strFire = "O";
+    for (int c = 0; c < cfg.numChannels; c++) {
+        if (chStates[c].motionGateOn)
+            cout << std::format("[{}]Motion gate: OD skipped on {} of {} frames\n", c, motionGates[c].getSkipped(),
+                chStates[c].frameCnt);
+        if (cfg.dupDetection)
+            cout << std::format("[{}]Duplicate frames: {} of {} (no OD/CC)\n", c, streamer.getDuplicates(c),
+                chStates[c].frameCnt);
+        if (cfg.adaptiveSchedule && (chStates[c].fdOn || chStates[c].ccOn))
+            cout << std::format("[{}]Scheduler: {} FD/CC runs in {} frames, {} deferred by the budget\n", c,
+                scheduler.getRuns(c), chStates[c].frameCnt, scheduler.getDeferred(c));
     }
 
-    if (fdRcd.smokeProbs.back() > fdScoreThSmoke) {
-        Mat smokeIconRegion = img(Rect(Point(sx - 4, sy - 2), Point(sx + 63 + 4, sy + 87 + 2)));
-        smokeIconRegion -= Scalar(100, 100, 100);
-        fillPoly(img, ptsSmoke, Scalar(200, 200, 200));
-
-        strSmoke = "O";
+    if (cfg.eventRecording)
+        cout << std::format("Event clips: {} written to {}, {} triggers dropped\n", recorder.getWritten(), cfg.clipDir,
+            recorder.getDropped());
+
+    cout << "\nLatency(ms):\n";
+    latency.print(cout, cfg.numChannels > 1);
+    if (inferFailures[INFER_OD] + inferFailures[INFER_FD] + inferFailures[INFER_CC] > 0)
+        cout << std::format("Inference failures (not in the latencies): OD {}, FD {}, CC {}\n",
+            inferFailures[INFER_OD], inferFailures[INFER_FD], inferFailures[INFER_CC]);
+    if (LATENCY_SNAPSHOT_SEC > 0)
+        latency.dumpCSV(LATENCY_SNAPSHOT_FILE, duration_cast<milliseconds>(steady_clock::now() - startRun).count() / 1000.0);
+
+    if (sumOD.num + sumFD.num + sumCC.num > 0)
+        cout << "\nStages(ms, simulated by generator_mock, see getLastStageTimings):\n";
+    if (sumOD.num > 0) {
+        cout << std::format("  OD: pre {:.2f}, infer {:.2f}, nms {:.2f}, track {:.2f}, par {:.2f} | boxes {:.1f} -> "
+                            "{:.1f}, par crops {:.1f} in {:.1f} batches\n",
+            sumOD.avgMs(sumOD.preUs), sumOD.avgMs(sumOD.inferUs), sumOD.avgMs(sumOD.nmsUs), sumOD.avgMs(sumOD.trackUs),
+            sumOD.avgMs(sumOD.parUs), sumOD.avg(sumOD.numBoxesPreNms), sumOD.avg(sumOD.numBoxesPostNms),
+            sumOD.avg(sumOD.numParCrops), sumOD.avg(sumOD.numParBatches));
     }
-
-    string fdText = "Event> Fire: " + strFire + ", Smoke: " + strSmoke;
-    Vis::drawTextBlockFD(img, fdRcd, vchID, 140, fdText, 1, 2);
-
-    // if (cfg.boostMode && (strSmoke == "O" || strFire == "O"))
-    //    rectangle(img, Rect(0, 0, img.cols, img.rows), Scalar(0, 0, 255), 4);    
-}
-
-void drawCC(Config& cfg, CCRecord& ccRcd, Mat& density, Mat& img, int vchID) {
-    if (cfg.boostMode) {
-        if (!density.empty()) {
-            vector<Mat> chans(3);
-
-            split(img, chans);
-            chans[2] += density;  // add to red channel
-            merge(chans, img);
-        }
-
-        float alpha = 0.7f;
-        int np[1] = { 4 };
-        cv::Mat layer;
-
-        for (CCZone& ccZone : ccRcd.ccZones) {
-            if (layer.empty())
-                layer = img.clone();
-
-            int z = ccZone.ccZoneID;
-            const Scalar color(50, 50, 255);
-            fillPoly(layer, { ccZone.pts }, color);
-        }
-
-        if (!layer.empty())
-            cv::addWeighted(img, alpha, layer, 1 - alpha, 0, img);
+    if (sumFD.num > 0) {
+        cout << std::format("  FD: pre {:.2f}, infer {:.2f}, post {:.2f}\n", sumFD.avgMs(sumFD.preUs),
+            sumFD.avgMs(sumFD.inferUs), sumFD.avgMs(sumFD.postUs));
     }
-    else {
-        for (CCZone& ccZone : ccRcd.ccZones) {
-            const Scalar color(20, 20, 255);
-            polylines(img, { ccZone.pts }, true, color, 2);
-        }
+    if (sumCC.num > 0) {
+        cout << std::format("  CC: pre {:.2f}, infer {:.2f}, post {:.2f}\n", sumCC.avgMs(sumCC.preUs),
+            sumCC.avgMs(sumCC.inferUs), sumCC.avgMs(sumCC.postUs));
     }
 
-    if (img.rows < 720 || img.cols < 1280)
-        return;
-
-    ////////////////////
-    // draw couniting results
-
-    vector<string> ccTexts;
-    ccTexts.push_back(string("Crowd Counting for Each CZone"));
-
-#ifndef _CPU_INFER
-    ccTexts.push_back(std::format("  Entire Area:{:>5}", ccRcd.ccNumFrames.back()));
-#endif
-
-    for (CCZone& ccZone : ccRcd.ccZones) {
-        string text =
-            // std::format(" -CZone {}: {:>4}", ccZone.ccZoneID+1, ccZone.ccNums.back());
-            std::format("  CZone {}:{:>7}(L{})", ccZone.ccZoneID, ccZone.ccNums.back(), ccZone.ccLevel);
-        ccTexts.push_back(text);
+    if (cfg.recording) {
+        cout << "\nOutput file(s):\n";
+        for (auto& outFile : cfg.outputFiles)
+            cout << std::format("  -{}\n", outFile);
     }
 
-    Vis::drawTextBlock(img, Point(img.cols - 555, 100), ccTexts, 1, 2);
+    streamer.destroy();  // destroy streamer
+    destroyModel();      // destroy all models
 
-    // for demo
-    //vector<string> tmp0 = {string("CZone 0")};
-    //Vis::drawTextBlock(img, Point(640, 250), tmp0, 1, 2);
+    cout << "\nTerminate program!\n";
 
-    //vector<string> tmp1 = { string("CZone 1") };
-    //Vis::drawTextBlock(img, Point(640, 600), tmp1, 1, 2);    
-}
\ No newline at end of file
+    return 0;
+}
@@ -0,0 +1,269 @@
+#include "metrics.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+typedef SOCKET SocketHandle;
+#define CLOSE_SOCKET closesocket
+#define SEND_FLAGS 0
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int SocketHandle;
+#define INVALID_SOCKET (-1)
+#define CLOSE_SOCKET close
+#define SEND_FLAGS MSG_NOSIGNAL  // a scraper that hung up must not raise SIGPIPE
+#endif
+
+#define METRICS_IO_TIMEOUT_MS 1000  // longest wait for a scraper to send its request or to take the response
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+struct MetricFamily {
+    string type;  /// counter, gauge or histogram
+    string help;
+    vector<pair<string, unique_ptr<MetricCounter>>> counters;  /// (labels, metric)
+    vector<pair<string, unique_ptr<MetricGauge>>> gauges;
+    vector<pair<string, unique_ptr<MetricHistogram>>> histograms;
+};
+
+struct MetricsState {
+    mutex m;  /// guards the families (not the values)
+    map<string, MetricFamily> families;
+
+    thread server;
+    atomic<bool> running{false};
+};
+
+MetricsState& state() {
+    static MetricsState s;
+    return s;
+}
+
+template <typename T, typename... Args>
+T& findOrAdd(vector<pair<string, unique_ptr<T>>>& metrics, const string& labels, Args&&... args) {
+    for (auto& [l, metric] : metrics)
+        if (l == labels)
+            return *metric;
+
+    metrics.emplace_back(labels, make_unique<T>(std::forward<Args>(args)...));
+    return *metrics.back().second;
+}
+
+MetricFamily& family(MetricsState& s, const string& name, const char* type, const string& help) {
+    MetricFamily& f = s.families[name];
+    if (f.type.empty()) {
+        f.type = type;
+        f.help = help;
+    }
+    return f;
+}
+
+string series(const string& name, const string& labels) {
+    return labels.empty() ? name : std::format("{}{{{}}}", name, labels);
+}
+
+string withLe(const string& labels, const string& le) {
+    return labels.empty() ? std::format("le=\"{}\"", le) : std::format("{},le=\"{}\"", labels, le);
+}
+
+void setTimeouts(SocketHandle client) {
+#ifdef _WIN32
+    DWORD timeout = METRICS_IO_TIMEOUT_MS;
+#else
+    timeval timeout{METRICS_IO_TIMEOUT_MS / 1000, (METRICS_IO_TIMEOUT_MS % 1000) * 1000};
+#endif
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+void serveOne(SocketHandle client) {
+    setTimeouts(client);  // a silent client must not stall the other scrapes, the dumps and stopServer
+
+    // the request line is not inspected: every path returns the metrics
+    char buf[1024];
+    if (recv(client, buf, sizeof(buf), 0) <= 0) {  // timeout, error or closed before a request
+        CLOSE_SOCKET(client);
+        return;
+    }
+
+    string body = Metrics::render();
+    string response = std::format(
+        "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: {}\r\nConnection: close\r\n\r\n",
+        body.size());
+    response += body;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        int n = send(client, response.data() + sent, (int)(response.size() - sent), SEND_FLAGS);
+        if (n <= 0)
+            break;  // timeout or error: drop the client
+        sent += n;
+    }
+
+    CLOSE_SOCKET(client);
+}
+
+}  // namespace
+
+MetricCounter& Metrics::counter(const std::string& name, const std::string& help, const std::string& labels) {
+    MetricsState& s = state();
+    lock_guard<mutex> lock(s.m);
+    return findOrAdd(family(s, name, "counter", help).counters, labels);
+}
+
+MetricGauge& Metrics::gauge(const std::string& name, const std::string& help, const std::string& labels) {
+    MetricsState& s = state();
+    lock_guard<mutex> lock(s.m);
+    return findOrAdd(family(s, name, "gauge", help).gauges, labels);
+}
+
+MetricHistogram& Metrics::histogram(const std::string& name, const std::string& help, const std::string& labels,
+    const std::vector<double>& bounds) {
+    MetricsState& s = state();
+    lock_guard<mutex> lock(s.m);
+    return findOrAdd(family(s, name, "histogram", help).histograms, labels, bounds);
+}
+
+std::string Metrics::render() {
+    MetricsState& s = state();
+    string out;
+
+    lock_guard<mutex> lock(s.m);
+    for (auto& [name, f] : s.families) {
+        out += std::format("# HELP {} {}\n# TYPE {} {}\n", name, f.help, name, f.type);
+
+        for (auto& [labels, c] : f.counters)
+            out += std::format("{} {}\n", series(name, labels), c->get());
+
+        for (auto& [labels, g] : f.gauges)
+            out += std::format("{} {}\n", series(name, labels), g->get());
+
+        for (auto& [labels, h] : f.histograms) {
+            const vector<double>& bounds = h->getBounds();
+            uint64_t cum = 0;
+
+            for (size_t i = 0; i < bounds.size(); i++) {
+                cum += h->getCount(i);
+                out += std::format("{} {}\n", series(name + "_bucket", withLe(labels, std::format("{}", bounds[i]))), cum);
+            }
+
+            cum += h->getCount(bounds.size());
+            out += std::format("{} {}\n", series(name + "_bucket", withLe(labels, "+Inf")), cum);
+            out += std::format("{} {}\n", series(name + "_sum", labels), h->getSum());
+            out += std::format("{} {}\n", series(name + "_count", labels), cum);
+        }
+    }
+
+    return out;
+}
+
+bool Metrics::dump(const std::string& filename) {
+    string tmp = filename + ".tmp";
+    {
+        ofstream out(tmp);
+        if (!out)
+            return false;
+        out << render();
+        if (!out)
+            return false;
+    }
+
+    error_code ec;
+    filesystem::rename(tmp, filename, ec);
+    return !ec;
+}
+
+bool Metrics::startServer(int port, const std::string& dumpFile, int dumpPeriodSec) {
+    MetricsState& s = state();
+    if (s.running)
+        return false;
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+        return false;
+#endif
+
+    SocketHandle listener = INVALID_SOCKET;
+    if (port > 0) {
+        listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener == INVALID_SOCKET)
+            return false;
+
+        int yes = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&yes, sizeof(yes));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((unsigned short)port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);  // localhost only
+
+        if (::bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 4) != 0) {
+            cout << std::format("Metrics: cannot listen on 127.0.0.1:{}\n", port);
+            CLOSE_SOCKET(listener);
+            return false;
+        }
+    }
+
+    s.running = true;
+    s.server = thread([&s, listener, dumpFile, dumpPeriodSec]() {
+        steady_clock::time_point nextDump = steady_clock::now() + seconds(dumpPeriodSec);
+
+        while (s.running) {
+            if (listener != INVALID_SOCKET) {
+                fd_set fds;
+                FD_ZERO(&fds);
+                FD_SET(listener, &fds);
+                timeval tv{0, 200 * 1000};  // wake up regularly for stopServer and the dumps
+
+                if (select((int)listener + 1, &fds, nullptr, nullptr, &tv) > 0) {
+                    SocketHandle client = accept(listener, nullptr, nullptr);
+                    if (client != INVALID_SOCKET)
+                        serveOne(client);
+                }
+            }
+            else {
+                this_thread::sleep_for(milliseconds(200));
+            }
+
+            if (!dumpFile.empty() && dumpPeriodSec > 0 && steady_clock::now() >= nextDump) {
+                dump(dumpFile);
+                nextDump += seconds(dumpPeriodSec);
+            }
+        }
+
+        if (listener != INVALID_SOCKET)
+            CLOSE_SOCKET(listener);
+    });
+
+    return true;
+}
+
+void Metrics::stopServer() {
+    MetricsState& s = state();
+    if (!s.running.exchange(false))
+        return;
+
+    s.server.join();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
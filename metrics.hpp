@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+/// monotonically increasing counter
+class MetricCounter {
+   public:
+    void inc(uint64_t n = 1) {
+        value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<uint64_t> value{0};
+};
+
+/// value that can go up and down
+class MetricGauge {
+   public:
+    void set(double v) {
+        value.store(v, std::memory_order_relaxed);
+    }
+
+    void add(double v) {
+        value.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    double get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::atomic<double> value{0.0};
+};
+
+/// histogram with fixed upper bounds (cumulative "le" buckets in the exposition)
+class MetricHistogram {
+   public:
+    explicit MetricHistogram(const std::vector<double>& bounds)
+        : bounds(bounds), counts(new std::atomic<uint64_t>[bounds.size() + 1]) {
+        for (size_t i = 0; i <= bounds.size(); i++)
+            counts[i] = 0;
+    }
+
+    void observe(double v) {
+        size_t i = 0;
+        while (i < bounds.size() && v > bounds[i])
+            i++;
+
+        counts[i].fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(v, std::memory_order_relaxed);
+    }
+
+    const std::vector<double>& getBounds() const {
+        return bounds;
+    }
+
+    /// count of bucket i (i == getBounds().size(): above the last bound)
+    uint64_t getCount(size_t i) const {
+        return counts[i].load(std::memory_order_relaxed);
+    }
+
+    double getSum() const {
+        return sum.load(std::memory_order_relaxed);
+    }
+
+   private:
+    std::vector<double> bounds;
+    std::unique_ptr<std::atomic<uint64_t>[]> counts;
+    std::atomic<double> sum{0.0};
+};
+
+/// @brief process-wide metrics registry with Prometheus text exposition
+/// Register the metrics at start-up (registration takes a lock and returns a reference that stays valid); updates are
+/// relaxed atomics, so the pipeline threads never wait for a scrape. A scrape or dump only reads the atomics.
+/// labels are given in exposition form, e.g. vchID="0",model="od".
+class Metrics {
+   public:
+    static MetricCounter& counter(const std::string& name, const std::string& help, const std::string& labels = "");
+    static MetricGauge& gauge(const std::string& name, const std::string& help, const std::string& labels = "");
+    static MetricHistogram& histogram(const std::string& name, const std::string& help, const std::string& labels,
+        const std::vector<double>& bounds);
+
+    /// Prometheus text format (version 0.0.4) of all metrics
+    static std::string render();
+
+    /// write render() to a file (replaced atomically)
+    static bool dump(const std::string& filename);
+
+    /// serve render() on http://127.0.0.1:port/metrics from a background thread, and dump it to dumpFile every
+    /// dumpPeriodSec (empty or 0: no dumps)
+    static bool startServer(int port, const std::string& dumpFile = "", int dumpPeriodSec = 0);
+
+    static void stopServer();
+};
@@ -0,0 +1,875 @@
+/*==============================================================================
+* Copyright 2024 AIPro Inc.
+* Author: Chun-Su Park (cspk@skku.edu)
+=============================================================================*/
+// Deterministic CPU-only implementation of generator.h (libgenerator_mock)
+// Outputs depend only on (vchID, frameCnt) or on the trajectory script, so runs are reproducible on any machine.
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <span>
+#include <sstream>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
+#include <opencv2/imgproc.hpp>
+
+#include "generator_mock.h"
+
+using namespace std;
+using namespace cv;
+using namespace std::chrono;
+
+/// inference context of the mock: scratch buffers only (the synthetic models are stateless)
+struct InferContextImpl {
+    int vchID;                  /// channel served by the context (-1: any channel)
+    vector<DetBox> candidates;  /// scratch buffer reused across frames
+    atomic<bool> inUse{false};  /// detects concurrent use of one context (contract violation)
+};
+
+namespace {
+
+struct ScriptEntry {
+    int vchID;
+    uint trackID;
+    uint frameStart, frameEnd;
+    float x0, y0, x1, y1;
+    int w, h;
+    float prob;
+};
+
+struct MockState {
+    MockParams params;
+    Config* pCfg = nullptr;
+    vector<ScriptEntry> script;
+    vector<uint> fdCnts;  /// runModelFD calls per channel (FD/CC have no frameCnt)
+    vector<uint> ccCnts;  /// runModelCC calls per channel
+    atomic<int> numContexts{0};
+    vector<ModelLoadInfo> loadInfos;  /// report of the last initModel
+};
+
+int envInt(const char* name, int def) {
+    const char* v = getenv(name);
+    return v ? atoi(v) : def;
+}
+
+float envFloat(const char* name, float def) {
+    const char* v = getenv(name);
+    return v ? (float)atof(v) : def;
+}
+
+string envStr(const char* name, const char* def) {
+    const char* v = getenv(name);
+    return v ? string(v) : string(def);
+}
+
+MockParams defaultParams() {
+    MockParams p;
+    p.numChannels = envInt("MOCK_NUM_CHANNELS", 1);
+    p.inputs = envStr("MOCK_INPUTS", "");
+    p.numObjs = envInt("MOCK_NUM_OBJS", 8);
+    p.script = envStr("MOCK_SCRIPT", "");
+    p.odMs = envFloat("MOCK_OD_MS", 10.0f);
+    p.parUsPerBox = envFloat("MOCK_PAR_US", 100.0f);
+    p.fdMs = envFloat("MOCK_FD_MS", 3.0f);
+    p.ccMs = envFloat("MOCK_CC_MS", 20.0f);
+    p.loadMs = envFloat("MOCK_LOAD_MS", 50.0f);
+    p.spin = envInt("MOCK_SPIN", 0) != 0;
+    return p;
+}
+
+MockState& state() {
+    static MockState s{defaultParams(), nullptr, {}, {}, {}, {0}, {}};
+    return s;
+}
+
+/// splitmix64: deterministic hash for all synthetic values
+uint64_t mix(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+float unit(uint64_t x) {  /// [0, 1)
+    return (mix(x) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/// artificial latency
+void mockWait(float ms) {
+    if (ms <= 0.0f)
+        return;
+
+    steady_clock::time_point deadline = steady_clock::now() + microseconds((long long)(ms * 1000));
+
+    if (state().params.spin) {
+        while (steady_clock::now() < deadline)
+            ;
+    }
+    else {
+        this_thread::sleep_until(deadline);
+    }
+}
+
+/// FNV-1a of the model file (of the file name when the file does not exist)
+uint64_t modelHash(const string& file) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto add = [&h](const char* p, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            h ^= (uchar)p[i];
+            h *= 0x100000001b3ULL;
+        }
+    };
+
+    ifstream in(file, ios::binary);
+    if (!in) {
+        add(file.data(), file.size());
+        return h;
+    }
+
+    char buf[1 << 16];
+    while (in.read(buf, sizeof(buf)) || in.gcount() > 0)
+        add(buf, (size_t)in.gcount());
+
+    return h;
+}
+
+/// load the engine of a model from cacheDir, or build it and store it there (a failed store only costs a rebuild)
+void loadEngine(ModelLoadInfo& info, const string& cacheDir) {
+    steady_clock::time_point start = steady_clock::now();
+    float buildMs = state().params.loadMs;
+    info.cacheHit = false;
+
+    if (cacheDir.empty()) {
+        mockWait(buildMs);
+    }
+    else {
+        // key: model hash + device
+        string key = std::format("{}_{:016x}_MOCK", info.name, modelHash(info.file));
+        filesystem::path path = filesystem::path(cacheDir) / (key + ".engine");
+
+        if (filesystem::exists(path)) {
+            info.cacheHit = true;
+            mockWait(buildMs / 5);
+        }
+        else {
+            mockWait(buildMs);
+
+            error_code ec;
+            filesystem::create_directories(cacheDir, ec);
+            ofstream out(path, ios::binary);
+            out << key << "\n";
+            if (!out)
+                cout << "mock: cannot write the engine cache " << path.string() << endl;
+        }
+    }
+
+    info.loadMs = (int)duration_cast<milliseconds>(steady_clock::now() - start).count();
+}
+
+/// mockWait that returns the elapsed time(us)
+int stageWait(float ms) {
+    steady_clock::time_point start = steady_clock::now();
+    mockWait(ms);
+    return (int)duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+/// record of a model with no call on the thread yet
+StageTimings noTimings() {
+    StageTimings st{};
+    st.model = -1;
+    return st;
+}
+
+/// see getLastStageTimings
+thread_local StageTimings lastTimings[NUM_INFER_MODELS] = {noTimings(), noTimings(), noTimings()};
+
+StageTimings& beginTimings(int model, int vchID) {
+    StageTimings& st = lastTimings[model];
+    st = StageTimings{};
+    st.model = model;
+    st.vchID = vchID;
+    return st;
+}
+
+bool loadScript(const string& filename, vector<ScriptEntry>& script) {
+    ifstream in(filename);
+    if (!in.is_open()) {
+        cout << "mock: can't open the trajectory script: " << filename << endl;
+        return false;
+    }
+
+    string line;
+    while (getline(in, line)) {
+        size_t comment = line.find('#');
+        if (comment != string::npos)
+            line.resize(comment);
+
+        istringstream ss(line);
+        ScriptEntry e;
+        if (!(ss >> e.vchID >> e.trackID >> e.frameStart >> e.frameEnd >> e.x0 >> e.y0 >> e.x1 >> e.y1 >> e.w >> e.h))
+            continue;
+
+        if (!(ss >> e.prob))
+            e.prob = 0.9f;
+
+        script.push_back(e);
+    }
+
+    return true;
+}
+
+/// fill the geometry of a box whose top-left corner is (x, y) now and (xP, yP) in the previous frame
+void setBox(DetBox& dbox, float x, float y, float xP, float yP, int w, int h, int frameW, int frameH) {
+    dbox.x = std::clamp((int)x, 0, std::max(frameW - 1, 0));
+    dbox.y = std::clamp((int)y, 0, std::max(frameH - 1, 0));
+    dbox.w = std::min(w, frameW - dbox.x);
+    dbox.h = std::min(h, frameH - dbox.y);
+    dbox.rx = dbox.x + dbox.w / 2;
+    dbox.ry = dbox.y + dbox.h;
+    dbox.rxP = std::clamp((int)xP, 0, std::max(frameW - 1, 0)) + dbox.w / 2;
+    dbox.ryP = std::clamp((int)yP, 0, std::max(frameH - 1, 0)) + dbox.h;
+    dbox.onBoundary = dbox.x == 0 || dbox.y == 0 || dbox.x + dbox.w >= frameW || dbox.y + dbox.h >= frameH;
+}
+
+void setAtts(DetBox& dbox, uint frameCnt, int attUpdatePeriod) {
+    int cls = mix(dbox.trackID) % NUM_ATTRIBUTES;
+
+    for (int a = 0; a < NUM_ATTRIBUTES; a++)
+        dbox.patts.atts[a] = (a == cls) ? 0.7f : 0.3f / (NUM_ATTRIBUTES - 1);
+
+    dbox.patts.setCnt = attUpdatePeriod > 0 ? frameCnt % attUpdatePeriod : 0;
+}
+
+/// procedural trajectories: numObjs objects crossing the frame on fixed lanes, respawned with a new trackID
+void genProcedural(vector<DetBox>& dboxes, int vchID, uint frameCnt, int frameW, int frameH, int numObjs) {
+    for (int k = 0; k < numObjs; k++) {
+        uint64_t seed = ((uint64_t)vchID << 32) | (uint64_t)k;
+        uint life = 150 + mix(seed) % 150;
+        uint phase = mix(seed + 1) % life;
+        uint cycle = (frameCnt + phase) / life;
+        uint t = (frameCnt + phase) % life;
+
+        int w = std::max(frameW / 24, 8);
+        int h = w * 5 / 2;
+        float lane = (0.1f + 0.8f * unit(seed + 2 + cycle)) * std::max(frameH - h, 1);
+        bool leftToRight = (mix(seed + 3 + cycle) & 1) != 0;
+
+        auto pos = [&](uint tt) {
+            float r = (float)tt / (life - 1);
+            float x = (leftToRight ? r : 1.0f - r) * (frameW - w);
+            float y = lane + 0.05f * frameH * sinf(tt * 0.05f);
+            return Point2f(x, y);
+        };
+
+        Point2f cur = pos(t), prev = pos(t > 0 ? t - 1 : 0);
+
+        DetBox dbox{};
+        dbox.trackID = 1 + k + (uint)numObjs * cycle;
+        dbox.prob = 0.4f + 0.6f * unit(seed + 4 + frameCnt);
+        setBox(dbox, cur.x, cur.y, prev.x, prev.y, w, h, frameW, frameH);
+        dboxes.push_back(dbox);
+    }
+}
+
+void genScripted(vector<DetBox>& dboxes, int vchID, uint frameCnt, int frameW, int frameH) {
+    for (ScriptEntry& e : state().script) {
+        if (e.vchID != vchID || frameCnt < e.frameStart || frameCnt > e.frameEnd)
+            continue;
+
+        float span = (float)std::max(e.frameEnd - e.frameStart, 1u);
+        float r = (frameCnt - e.frameStart) / span;
+        float rP = (frameCnt > e.frameStart ? frameCnt - 1 - e.frameStart : 0) / span;
+
+        DetBox dbox{};
+        dbox.trackID = e.trackID;
+        dbox.prob = e.prob;
+        setBox(dbox, e.x0 + (e.x1 - e.x0) * r, e.y0 + (e.y1 - e.y0) * r, e.x0 + (e.x1 - e.x0) * rP,
+            e.y0 + (e.y1 - e.y0) * rP, e.w, e.h, frameW, frameH);
+        dboxes.push_back(dbox);
+    }
+}
+
+/// +1/-1: side of p relative to the line a->b (0: on the line)
+int side(Point a, Point b, Point p) {
+    long long c = (long long)(b.x - a.x) * (p.y - a.y) - (long long)(b.y - a.y) * (p.x - a.x);
+    return (c > 0) - (c < 0);
+}
+
+/// zone occupancy and line crossings of the current boxes
+void count(ODRecord& odRcd, std::span<DetBox> dboxes) {
+    for (Zone& zone : odRcd.zones) {
+        if (!zone.enabled || zone.pts.size() < 3)
+            continue;
+
+        for (int g = 0; g < NUM_GENDERS; g++)
+            for (int a = 0; a < NUM_AGE_GROUPS; a++)
+                zone.curPeople[g][a] = 0;
+
+        for (DetBox& dbox : dboxes) {
+            bool in = pointPolygonTest(zone.pts, Point2f(dbox.rx, dbox.ry), false) >= 0;
+            bool inP = pointPolygonTest(zone.pts, Point2f(dbox.rxP, dbox.ryP), false) >= 0;
+            int g = PedAtts::getGenderAtt(dbox.patts) ? FEMALE : MALE;
+            int a = PedAtts::getAgeGroupAtt(dbox.patts);
+
+            if (in)
+                zone.curPeople[g][a]++;
+
+            if (in && !inP) {
+                zone.hitMap[g][a]++;
+                dbox.justCountedZone = 15;
+            }
+        }
+    }
+
+    for (CntLine& cntLine : odRcd.cntLines) {
+        if (!cntLine.enabled)
+            continue;
+
+        Point a = cntLine.pts[0], b = cntLine.pts[1];
+        for (DetBox& dbox : dboxes) {
+            Point p(dbox.rx, dbox.ry), pP(dbox.rxP, dbox.ryP);
+            int s = side(a, b, p), sP = side(a, b, pP);
+
+            if (s == 0 || sP == 0 || s == sP || side(p, pP, a) == side(p, pP, b))
+                continue;
+
+            int g = PedAtts::getGenderAtt(dbox.patts) ? FEMALE : MALE;
+            int age = PedAtts::getAgeGroupAtt(dbox.patts);
+            bool upLeft = cntLine.direction == 0 ? (dbox.ry < dbox.ryP) : (dbox.rx < dbox.rxP);
+
+            if (upLeft)
+                cntLine.totalUL[g][age]++;
+            else
+                cntLine.totalDR[g][age]++;
+
+            dbox.justCountedLine = 15;
+        }
+    }
+}
+
+/// synthetic fire/smoke probability: a burst of 90 calls every 600 calls (phase shifted per channel)
+float burst(uint cnt, int vchID, int offset) {
+    uint t = (cnt + vchID * 97 + offset) % 600;
+    if (t >= 90)
+        return 0.05f;
+
+    return 0.05f + 0.9f * sinf((float)CV_PI * t / 90);
+}
+
+void pushProb(std::deque<float>& probs, float prob) {
+    if (!probs.empty())
+        probs.pop_front();
+    probs.push_back(prob);
+}
+
+/// draw count blobs in rect of density and return the number of blobs
+int drawBlobs(Mat& density, Rect rect, int count, uint64_t seed) {
+    int radius = std::max(std::min(rect.width, rect.height) / 40, 2);
+
+    for (int i = 0; i < count; i++) {
+        Point c(rect.x + (int)(unit(seed + 2 * i) * rect.width), rect.y + (int)(unit(seed + 2 * i + 1) * rect.height));
+        circle(density, c, radius, Scalar(200), FILLED);
+    }
+
+    return count;
+}
+
+}  // namespace
+
+void mockConfigure(const MockParams& params) {
+    state().params = params;
+}
+
+MockParams mockGetParams() {
+    return state().params;
+}
+
+bool getDLLInfo(std::string& _device, int& _versionX10, bool& _testMode, int& _numInfLimit) {
+    _device = "MOCK";
+    _versionX10 = 10;
+    _testMode = true;
+    _numInfLimit = 0;
+    return true;
+}
+
+bool parseConfigAPI(Config& cfg, std::vector<CInfo>& cInfos, const char* cfgFilename) {
+    MockParams& p = state().params;
+    int n = std::max(p.numChannels, 1);
+
+    cout << "mock: synthetic config with " << n << " channel(s) (" << cfgFilename << " is not parsed)\n";
+
+    cfg.key = "mock";
+    cfg.frameLimit = 0;
+    cfg.recording = false;
+    cfg.boostMode = false;
+    cfg.igpuEnable = false;
+    cfg.numChannels = n;
+
+    vector<string> inputs;
+    stringstream ss(p.inputs);
+    for (string s; getline(ss, s, ',');)
+        if (!s.empty())
+            inputs.push_back(s);
+
+    cfg.inputFiles.clear();
+    cfg.outputFiles.clear();
+    for (int vchID = 0; vchID < n; vchID++) {
+        cfg.inputFiles.push_back(vchID < (int)inputs.size() ? inputs[vchID] : "videos/mock" + to_string(vchID) + ".mp4");
+        cfg.outputFiles.push_back("outputs/mock" + to_string(vchID) + ".mp4");
+    }
+
+    cfg.frameWidths.assign(n, 1920);
+    cfg.frameHeights.assign(n, 1080);
+    cfg.fpss.assign(n, 30.0f);
+
+    cfg.odEnable = true;
+    cfg.odModelFile = "mock_od";
+    cfg.irModelFile = "mock_ir";
+    cfg.odNetWidth = NET_WIDTH_OD;
+    cfg.odNetHeight = NET_HEIGHT_OD;
+    cfg.odScaleFactors.assign(n, 1.0f);
+    cfg.odScaleFactorsInv.assign(n, 1.0f);
+    cfg.odScoreTh = 0.5f;
+    cfg.odBatchSize = 1;
+    cfg.odIDMapping = {"person"};
+    cfg.numClasses = 1;
+    cfg.odEboxCheckEnable = false;
+    cfg.odEboxFilterEnable = false;
+    cfg.odFMapEnable = false;
+    cfg.odFMapParams.clear();
+
+    cfg.srEnable = false;
+    cfg.srModelFile = "mock_sr";
+    cfg.srNetWidth = NET_WIDTH_SR;
+    cfg.srNetHeight = NET_HEIGHT_SR;
+    cfg.srScaleFactor = 2;
+    cfg.srDeltaScoreTh = 0.1f;
+
+    cfg.odChannels.assign(n, OD_MODE_RGB);
+    cfg.fdChannels.assign(n, 1);
+    cfg.ccChannels.assign(n, 1);
+
+    cfg.fdEnable = true;
+    cfg.fdModelFile = "mock_fd";
+    cfg.fdNetWidth = NET_WIDTH_FD;
+    cfg.fdNetHeight = NET_HEIGHT_FD;
+    cfg.fdScaleFactors.assign(n, 1.0f);
+    cfg.fdScoreThFire = 0.5f;
+    cfg.fdScoreThSmoke = 0.5f;
+    cfg.fdReliableTh = 0.5f;
+    cfg.fdBatchSize = 1;
+    cfg.fdWindowSize = 30;
+    cfg.fdNumClasses = NUM_FD_CLASSES;
+    cfg.fdPeriod = 1;
+#ifndef _CPU_INFER
+    cfg.fdTemporalStabilization = false;
+    cfg.fdDrawBlockDebug = false;
+#endif
+
+    cfg.longLastingObjTh = 60;
+    cfg.noMoveTh = 10.0f;
+    cfg.debouncingTh = 10;
+
+    cfg.parEnable = true;
+    cfg.parLightMode = false;
+    cfg.parModelFile = "mock_par";
+    cfg.parIDMapping = {"female_adult", "female_child", "female_old", "male_adult", "male_child", "male_old"};
+    cfg.numAtts = NUM_ATTRIBUTES;
+    cfg.attUpdatePeriod = 10;
+    cfg.parBatchSize = 8;
+
+    cfg.ccEnable = true;
+    cfg.ccNetWidth = NET_WIDTH_CC;
+    cfg.ccNetHeight = NET_HEIGHT_CC;
+    cfg.ccScaleFactors.assign(n, 1.0f);
+    cfg.ccModelFile = "mock_cc";
+    cfg.ccWindowSize = 10;
+    cfg.ccPeriod = 1;
+
+    // geometry fits frames of 640x360 or larger
+    cInfos.clear();
+    cInfos.resize(n);
+    for (int vchID = 0; vchID < n; vchID++) {
+        CInfo& cInfo = cInfos[vchID];
+
+        cInfo.odRcd.vchID = vchID;
+        Zone zone{};
+        zone.enabled = true;
+        zone.zoneID = 0;
+        zone.vchID = vchID;
+        zone.isMode = IS_PEOPLE_COUNTING;
+        zone.pts = {Point(40, 40), Point(300, 40), Point(300, 320), Point(40, 320)};
+        zone.init();
+        cInfo.odRcd.zones.push_back(zone);
+
+        CntLine cntLine{};
+        cntLine.enabled = true;
+        cntLine.clineID = 0;
+        cntLine.vchID = vchID;
+        cntLine.direction = 1;
+        cntLine.isMode = IS_PEOPLE_COUNTING;
+        cntLine.pts[0] = Point(320, 20);
+        cntLine.pts[1] = Point(320, 340);
+        cntLine.init();
+        cInfo.odRcd.cntLines.push_back(cntLine);
+
+        cInfo.fdRcd.vchID = vchID;
+        cInfo.fdRcd.fireProbs.assign(cfg.fdWindowSize, 0.0f);
+        cInfo.fdRcd.smokeProbs.assign(cfg.fdWindowSize, 0.0f);
+        cInfo.fdRcd.afterFireEvent = 0;
+
+        cInfo.ccRcd.vchID = vchID;
+        cInfo.ccRcd.ccNumFrames.assign(cfg.ccWindowSize, 0);
+        CCZone ccZone{};
+        ccZone.enabled = true;
+        ccZone.ccZoneID = 0;
+        ccZone.vchID = vchID;
+        ccZone.pts = {Point(340, 40), Point(620, 40), Point(620, 340), Point(340, 340)};
+        ccZone.ccLevelThs[0] = 5;
+        ccZone.ccLevelThs[1] = 10;
+        ccZone.ccLevelThs[2] = 20;
+        ccZone.init();
+        ccZone.ccNums.assign(cfg.ccWindowSize, 0);
+        cInfo.ccRcd.ccZones.push_back(ccZone);
+
+        cInfo.superEye.init(vchID);
+    }
+
+    return true;
+}
+
+bool initModel(Config& cfg) {
+    MockState& s = state();
+    s.pCfg = &cfg;
+    s.fdCnts.assign(cfg.numChannels, 0);
+    s.ccCnts.assign(cfg.numChannels, 0);
+
+    s.script.clear();
+    if (!s.params.script.empty() && !loadScript(s.params.script, s.script))
+        return false;
+
+    // (name, file, latency of one inference)
+    vector<tuple<string, string, float>> models;
+    if (cfg.odEnable) {
+        models.emplace_back("od", cfg.odModelFile, s.params.odMs);
+        models.emplace_back("ir", cfg.irModelFile, s.params.odMs);
+    }
+    if (cfg.fdEnable)
+        models.emplace_back("fd", cfg.fdModelFile, s.params.fdMs);
+    if (cfg.parEnable)
+        models.emplace_back("par", cfg.parModelFile, s.params.parUsPerBox * cfg.parBatchSize / 1000.0f);
+    if (cfg.ccEnable)
+        models.emplace_back("cc", cfg.ccModelFile, s.params.ccMs);
+    if (cfg.srEnable)
+        models.emplace_back("sr", cfg.srModelFile, s.params.odMs);
+
+    s.loadInfos.assign(models.size(), ModelLoadInfo{});
+    auto load = [&](int m) {
+        auto& [name, file, inferMs] = models[m];
+        ModelLoadInfo& info = s.loadInfos[m];
+        info.name = name;
+        info.file = file;
+
+        loadEngine(info, cfg.engineCacheDir);
+
+        steady_clock::time_point start = steady_clock::now();
+        for (int r = 0; r < cfg.warmupRuns; r++)
+            mockWait(inferMs);
+        info.warmupMs = (int)duration_cast<milliseconds>(steady_clock::now() - start).count();
+    };
+
+    if (cfg.parallelLoad) {
+        vector<thread> loaders;
+        for (int m = 0; m < (int)models.size(); m++)
+            loaders.emplace_back(load, m);
+        for (thread& t : loaders)
+            t.join();
+    }
+    else {
+        for (int m = 0; m < (int)models.size(); m++)
+            load(m);
+    }
+
+    return true;
+}
+
+bool getModelLoadInfo(std::vector<ModelLoadInfo>& infos) {
+    infos = state().loadInfos;
+    return !infos.empty();
+}
+
+namespace {
+
+/// marks a context as used by the calling thread for the duration of one call
+class ContextUse {
+   public:
+    ContextUse(InferContext ctx, int vchID) : ctx(ctx) {
+        if (ctx->vchID >= 0 && ctx->vchID != vchID) {
+            cout << "mock: context of vchID " << ctx->vchID << " used for vchID " << vchID << endl;
+            return;
+        }
+
+        if (ctx->inUse.exchange(true)) {
+            cout << "mock: context used by two threads at the same time (vchID " << vchID << ")" << endl;
+            return;
+        }
+
+        acquired = true;
+    }
+
+    ~ContextUse() {
+        if (acquired)
+            ctx->inUse.store(false);
+    }
+
+    bool ok() const {
+        return acquired;
+    }
+
+   private:
+    InferContext ctx;
+    bool acquired = false;
+};
+
+void genCandidates(vector<DetBox>& candidates, int vchID, uint frameCnt, cv::Mat& frame) {
+    MockState& s = state();
+    candidates.clear();
+
+    if (s.script.empty())
+        genProcedural(candidates, vchID, frameCnt, frame.cols, frame.rows, s.params.numObjs);
+    else
+        genScripted(candidates, vchID, frameCnt, frame.cols, frame.rows);
+}
+
+/// write the kept candidates into dboxes and return their number (> dboxes.size(): overflow, the rest is dropped)
+int writeOD(vector<DetBox>& candidates, std::span<DetBox> dboxes, int& filteredObjCnt, CInfo& cInfo, int vchID,
+    uint frameCnt, float odScoreTh) {
+    MockState& s = state();
+    int attUpdatePeriod = s.pCfg ? s.pCfg->attUpdatePeriod : 10;
+    int parBatchSize = s.pCfg ? std::max(s.pCfg->parBatchSize, 1) : 8;
+    bool parEnable = s.pCfg ? s.pCfg->parEnable : true;
+    int numBoxes = 0;
+    filteredObjCnt = 0;
+
+    // odMs is split into preprocessing 15%, inference 60%, nms 10% and tracking 15%
+    StageTimings& st = beginTimings(INFER_OD, vchID);
+    st.preUs = stageWait(s.params.odMs * 0.15f);
+    st.inferUs = stageWait(s.params.odMs * 0.6f);
+    st.numBoxesPreNms = (int)candidates.size();
+
+    steady_clock::time_point start = steady_clock::now();
+    for (DetBox& dbox : candidates) {
+        if (dbox.prob < odScoreTh || dbox.w <= 0 || dbox.h <= 0) {
+            filteredObjCnt++;
+            continue;
+        }
+
+        if (numBoxes++ >= (int)dboxes.size())
+            continue;
+
+        dbox.objID = OD_ID_PERSON;
+        dbox.vchID = vchID;
+        dbox.frameCnt = frameCnt;
+        dbox.inTime = 0;
+        dbox.lastFrameCnt = frameCnt;
+        dbox.distVar = 0.0f;
+        dbox.justCountedLine = 0;
+        dbox.justCountedZone = 0;
+        setAtts(dbox, frameCnt, attUpdatePeriod);
+        dboxes[numBoxes - 1] = dbox;
+
+        // PAR runs on each track once every attUpdatePeriod frames (staggered by trackID)
+        if (parEnable && (attUpdatePeriod <= 0 || (frameCnt + dbox.trackID) % attUpdatePeriod == 0))
+            st.numParCrops++;
+    }
+    mockWait(s.params.odMs * 0.1f);
+    st.nmsUs = (int)duration_cast<microseconds>(steady_clock::now() - start).count();
+    st.numBoxesPostNms = numBoxes;
+
+    int numWritten = std::min(numBoxes, (int)dboxes.size());
+    start = steady_clock::now();
+    count(cInfo.odRcd, dboxes.first(numWritten));
+    mockWait(s.params.odMs * 0.15f);
+    st.trackUs = (int)duration_cast<microseconds>(steady_clock::now() - start).count();
+
+    st.numParBatches = (st.numParCrops + parBatchSize - 1) / parBatchSize;
+    st.parUs = stageWait(s.params.parUsPerBox * st.numParCrops / 1000.0f);
+
+    return numBoxes;
+}
+
+int runOD(vector<DetBox>& candidates, std::span<DetBox> dboxes, int& filteredObjCnt, CInfo& cInfo, cv::Mat& frame,
+    int vchID, uint frameCnt, float odScoreTh) {
+    genCandidates(candidates, vchID, frameCnt, frame);
+    return writeOD(candidates, dboxes, filteredObjCnt, cInfo, vchID, frameCnt, odScoreTh);
+}
+
+/// vector output: sized to the candidates, so a vector reused across frames stops reallocating after warm-up
+bool runOD(vector<DetBox>& candidates, std::vector<DetBox>& dboxes, int& filteredObjCnt, CInfo& cInfo, cv::Mat& frame,
+    int vchID, uint frameCnt, float odScoreTh) {
+    genCandidates(candidates, vchID, frameCnt, frame);
+
+    dboxes.resize(candidates.size());
+    int numBoxes = writeOD(candidates, dboxes, filteredObjCnt, cInfo, vchID, frameCnt, odScoreTh);
+    dboxes.resize(numBoxes);
+
+    return true;
+}
+
+}  // namespace
+
+bool runModel(std::vector<DetBox>& dboxes, int& filteredObjCnt, CInfo& cInfo, cv::Mat& frame, int vchID,
+    uint frameCnt, float odScoreTh) {
+    thread_local vector<DetBox> candidates;
+    return runOD(candidates, dboxes, filteredObjCnt, cInfo, frame, vchID, frameCnt, odScoreTh);
+}
+
+int runModel(std::span<DetBox> dboxes, int& filteredObjCnt, CInfo& cInfo, cv::Mat& frame, int vchID, uint frameCnt,
+    float odScoreTh) {
+    thread_local vector<DetBox> candidates;
+    return runOD(candidates, dboxes, filteredObjCnt, cInfo, frame, vchID, frameCnt, odScoreTh);
+}
+
+bool runModelFD(FDRecord& fdRcd, cv::Mat& frame, int vchID, int& detectedClassID) {
+    MockState& s = state();
+    uint cnt = vchID < (int)s.fdCnts.size() ? s.fdCnts[vchID]++ : 0;
+
+    // fdMs is split into preprocessing 20%, inference 70% and smoothing 10%
+    StageTimings& st = beginTimings(INFER_FD, vchID);
+    st.preUs = stageWait(s.params.fdMs * 0.2f);
+    st.inferUs = stageWait(s.params.fdMs * 0.7f);
+
+    steady_clock::time_point start = steady_clock::now();
+    float fire = burst(cnt, vchID, 0);
+    float smoke = burst(cnt, vchID, 45);
+    float none = 1.0f - std::max(fire, smoke);
+
+    pushProb(fdRcd.fireProbs, fire);
+    pushProb(fdRcd.smokeProbs, smoke);
+
+    if (fire >= smoke && fire >= none)
+        detectedClassID = FD_CLASS_FIRE;
+    else if (smoke >= none)
+        detectedClassID = FD_CLASS_SMOKE;
+    else
+        detectedClassID = FD_CLASS_NONE;
+
+    mockWait(s.params.fdMs * 0.1f);
+    st.postUs = (int)duration_cast<microseconds>(steady_clock::now() - start).count();
+
+    return true;
+}
+
+bool runModelCC(cv::Mat& density, CCRecord& ccRcd, cv::Mat& frame, int vchID) {
+    MockState& s = state();
+    uint cnt = vchID < (int)s.ccCnts.size() ? s.ccCnts[vchID]++ : 0;
+    uint64_t seed = mix(((uint64_t)vchID << 32) | cnt);
+    int total = 0;
+
+    // ccMs is split into preprocessing 20%, inference 70% and post-processing 10%
+    StageTimings& st = beginTimings(INFER_CC, vchID);
+    st.preUs = stageWait(s.params.ccMs * 0.2f);
+    st.inferUs = stageWait(s.params.ccMs * 0.7f);
+
+    steady_clock::time_point start = steady_clock::now();
+    density.create(frame.size(), CV_8UC1);  // a preallocated density of this size is written in place
+    density.setTo(0);
+    for (CCZone& ccZone : ccRcd.ccZones) {
+        Rect rect = boundingRect(ccZone.pts) & Rect(0, 0, frame.cols, frame.rows);
+        int num = 5 + (int)(10 * (1.0f + sinf((cnt + ccZone.ccZoneID * 31) * 0.02f)));
+
+        total += drawBlobs(density, rect, num, seed + ccZone.ccZoneID * 1000);
+        ccZone.pushCCNum(num);
+    }
+
+    if (!ccRcd.ccNumFrames.empty())
+        ccRcd.ccNumFrames.pop_front();
+    ccRcd.ccNumFrames.push_back(total);
+
+    mockWait(s.params.ccMs * 0.1f);
+    st.postUs = (int)duration_cast<microseconds>(steady_clock::now() - start).count();
+
+    return true;
+}
+
+bool getLastStageTimings(int model, StageTimings& timings) {
+    if (model < 0 || model >= NUM_INFER_MODELS || lastTimings[model].model != model)
+        return false;
+
+    timings = lastTimings[model];
+    return true;
+}
+
+InferContext createContext(int vchID) {
+    MockState& s = state();
+    if (!s.pCfg || vchID >= s.pCfg->numChannels)
+        return nullptr;
+
+    InferContext ctx = new InferContextImpl();
+    ctx->vchID = vchID;
+    s.numContexts++;
+
+    return ctx;
+}
+
+bool destroyContext(InferContext ctx) {
+    if (!ctx)
+        return false;
+
+    delete ctx;
+    state().numContexts--;
+
+    return true;
+}
+
+bool runModel(InferContext ctx, std::vector<DetBox>& dboxes, int& filteredObjCnt, CInfo& cInfo, cv::Mat& frame,
+    int vchID, uint frameCnt, float odScoreTh) {
+    ContextUse use(ctx, vchID);
+    if (!use.ok())
+        return false;
+
+    return runOD(ctx->candidates, dboxes, filteredObjCnt, cInfo, frame, vchID, frameCnt, odScoreTh);
+}
+
+int runModel(InferContext ctx, std::span<DetBox> dboxes, int& filteredObjCnt, CInfo& cInfo, cv::Mat& frame,
+    int vchID, uint frameCnt, float odScoreTh) {
+    ContextUse use(ctx, vchID);
+    if (!use.ok())
+        return -1;
+
+    return runOD(ctx->candidates, dboxes, filteredObjCnt, cInfo, frame, vchID, frameCnt, odScoreTh);
+}
+
+bool runModelFD(InferContext ctx, FDRecord& fdRcd, cv::Mat& frame, int vchID, int& detectedClassID) {
+    ContextUse use(ctx, vchID);
+    if (!use.ok())
+        return false;
+
+    return runModelFD(fdRcd, frame, vchID, detectedClassID);
+}
+
+bool runModelCC(InferContext ctx, cv::Mat& density, CCRecord& ccRcd, cv::Mat& frame, int vchID) {
+    ContextUse use(ctx, vchID);
+    if (!use.ok())
+        return false;
+
+    return runModelCC(density, ccRcd, frame, vchID);
+}
+
+bool destroyModel() {
+    MockState& s = state();
+    if (s.numContexts > 0)
+        cout << "mock: destroyModel with " << s.numContexts << " live context(s)" << endl;
+
+    s.pCfg = nullptr;
+    s.script.clear();
+    return true;
+}
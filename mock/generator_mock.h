@@ -0,0 +1,39 @@
+/*==============================================================================
+* Copyright 2024 AIPro Inc.
+* Author: Chun-Su Park (cspk@skku.edu)
+=============================================================================*/
+#pragma once
+
+#include "generator.h"
+
+/// parameters of the mock backend (libgenerator_mock)
+/// defaults are read from the environment (MOCK_*) at load time and can be overridden with mockConfigure
+struct MockParams {
+    int numChannels;      /// MOCK_NUM_CHANNELS: channels created by parseConfigAPI
+    std::string inputs;   /// MOCK_INPUTS: comma separated input files for parseConfigAPI (default: videos/mock<vchID>.mp4)
+    int numObjs;          /// MOCK_NUM_OBJS: synthetic objects per channel (without a script)
+    std::string script;   /// MOCK_SCRIPT: trajectory script (see below); overrides numObjs when set
+
+    float odMs;           /// MOCK_OD_MS: artificial latency of runModel
+    float parUsPerBox;    /// MOCK_PAR_US: additional latency of runModel per PAR crop (see attUpdatePeriod)
+    float fdMs;           /// MOCK_FD_MS: artificial latency of runModelFD
+    float ccMs;           /// MOCK_CC_MS: artificial latency of runModelCC
+    float loadMs;         /// MOCK_LOAD_MS: artificial build time of a model in initModel (a cached engine: 1/5)
+    bool spin;            /// MOCK_SPIN: busy-wait instead of sleeping (simulates CPU inference)
+};
+
+/// Trajectory script: one object per line, "#" starts a comment
+///   vchID trackID frameStart frameEnd x0 y0 x1 y1 w h [prob]
+/// the box moves linearly from (x0, y0) at frameStart to (x1, y1) at frameEnd (top-left corners, frame coordinates)
+
+/** @brief Override the mock parameters (call before parseConfigAPI/initModel)
+ *
+ * @param params new parameters
+ */
+GENERATOR_API void mockConfigure(const MockParams& params);
+
+/** @brief Get the current mock parameters
+ *
+ * @return current parameters
+ */
+GENERATOR_API MockParams mockGetParams();
@@ -0,0 +1,269 @@
+/*==============================================================================
+* Copyright 2024 AIPro Inc.
+* Author: Chun-Su Park (cspk@skku.edu)
+=============================================================================*/
+// Stress run of the inference context contract on the mock backend.
+// N threads x M channels run OD/FD/CC concurrently on their own contexts (even threads: one context per channel,
+// odd threads: one worker context for all of their channels). The results of every frame are compared with a
+// sequential reference run, and a mismatch or a rejected call fails the run. Then the same channels run as coroutines
+// on an InferLoop (one per channel, co_awaiting submitModel*) driven by numThreads client threads, and are compared
+// with the same reference.
+//
+// usage: mock_stress [numThreads] [channelsPerThread] [numFrames]
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cccanvas.h"
+#include "generator_mock.h"
+#include "inferloop.h"
+
+using namespace std;
+using namespace cv;
+using namespace std::chrono;
+
+struct FrameResult {
+    uint64_t odHash;
+    uint64_t fdHash;
+    uint64_t ccHash;
+};
+
+static uint64_t fnv(uint64_t h, uint64_t v) {
+    for (int i = 0; i < 8; i++) {
+        h ^= (v >> (i * 8)) & 0xff;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static const uint64_t FNV_BASIS = 0xcbf29ce484222325ULL;
+
+/// hash the outputs of one frame of a channel
+static void hashFrame(const vector<DetBox>& dboxes, int filteredObjCnt, int detectedClassID, CInfo& cInfo,
+    FrameResult& res) {
+    res.odHash = fnv(FNV_BASIS, filteredObjCnt);
+    for (const DetBox& d : dboxes) {
+        res.odHash = fnv(res.odHash, d.trackID);
+        res.odHash = fnv(res.odHash, ((uint64_t)d.x << 32) | (uint32_t)d.y);
+        res.odHash = fnv(res.odHash, ((uint64_t)d.w << 32) | (uint32_t)d.h);
+    }
+    for (Zone& z : cInfo.odRcd.zones)
+        res.odHash = fnv(res.odHash, z.getTotal());
+    for (CntLine& c : cInfo.odRcd.cntLines)
+        res.odHash = fnv(res.odHash, c.getTotal());
+
+    res.fdHash = fnv(FNV_BASIS, detectedClassID);
+    res.fdHash = fnv(res.fdHash, (uint64_t)(cInfo.fdRcd.fireProbs.back() * 1e6));
+
+    res.ccHash = fnv(FNV_BASIS, cInfo.ccRcd.ccNumFrames.back());
+    for (CCZone& z : cInfo.ccRcd.ccZones)
+        res.ccHash = fnv(res.ccHash, z.ccNums.back());
+
+}
+
+/// run one frame of a channel (on ctx, or context-free when ctx is nullptr) and hash the outputs
+static bool runFrame(InferContext ctx, CInfo& cInfo, Mat& frame, int vchID, uint frameCnt, float odScoreTh,
+    FrameResult& res) {
+    vector<DetBox> dboxes;
+    int filteredObjCnt = 0, detectedClassID = -1;
+    Mat density;
+    bool ok = true;
+
+    ok &= ctx ? runModel(ctx, dboxes, filteredObjCnt, cInfo, frame, vchID, frameCnt, odScoreTh)
+              : runModel(dboxes, filteredObjCnt, cInfo, frame, vchID, frameCnt, odScoreTh);
+    ok &= ctx ? runModelFD(ctx, cInfo.fdRcd, frame, vchID, detectedClassID)
+              : runModelFD(cInfo.fdRcd, frame, vchID, detectedClassID);
+#ifdef _CPU_INFER
+    thread_local unordered_map<int, CCCanvas> ccCanvases;  // per channel of the calling thread (one run each)
+    ccCanvases[vchID].setCanvas(cInfo.ccRcd, frame);
+#endif
+    ok &= ctx ? runModelCC(ctx, density, cInfo.ccRcd, frame, vchID)
+              : runModelCC(density, cInfo.ccRcd, frame, vchID);
+
+    hashFrame(dboxes, filteredObjCnt, detectedClassID, cInfo, res);
+
+    return ok;
+}
+
+/// one channel as a coroutine on loop: the frames of runFrame, with every inference co_awaited
+static InferTask runChannel(InferLoop& loop, CInfo& cInfo, const Mat& srcFrame, int vchID, int numFrames,
+    float odScoreTh, const vector<FrameResult>& expected, atomic<int>& mismatches, atomic<int>& failures,
+    atomic<int>& running) {
+    Mat frame = srcFrame.clone();
+    vector<DetBox> dboxes;
+    Mat density;
+#ifdef _CPU_INFER
+    CCCanvas ccCanvas;  // coroutines move between the loop threads: no thread_local canvases
+#endif
+
+    for (int f = 0; f < numFrames; f++) {
+        int filteredObjCnt = 0, detectedClassID = -1;
+        bool ok = true;
+
+        ok &= co_await loop.submit([&](InferCallback cb, void* ud) {
+            return submitModel(dboxes, filteredObjCnt, cInfo, frame, vchID, f, odScoreTh, cb, ud);
+        });
+        ok &= co_await loop.submit([&](InferCallback cb, void* ud) {
+            return submitModelFD(cInfo.fdRcd, frame, vchID, detectedClassID, cb, ud);
+        });
+#ifdef _CPU_INFER
+        ccCanvas.setCanvas(cInfo.ccRcd, frame);
+#endif
+        ok &= co_await loop.submit([&](InferCallback cb, void* ud) {
+            return submitModelCC(density, cInfo.ccRcd, frame, vchID, cb, ud);
+        });
+
+        FrameResult res;
+        hashFrame(dboxes, filteredObjCnt, detectedClassID, cInfo, res);
+
+        if (!ok)
+            failures++;
+
+        const FrameResult& exp = expected[f];
+        if (res.odHash != exp.odHash || res.fdHash != exp.fdHash || res.ccHash != exp.ccHash)
+            mismatches++;
+    }
+
+    if (--running == 0)
+        loop.stop();
+}
+
+int main(int argc, char** argv) {
+    int numThreads = argc > 1 ? atoi(argv[1]) : 4;
+    int channelsPerThread = argc > 2 ? atoi(argv[2]) : 4;
+    int numFrames = argc > 3 ? atoi(argv[3]) : 300;
+    if (numThreads < 1 || channelsPerThread < 1 || numFrames < 1) {
+        printf("usage: mock_stress [numThreads] [channelsPerThread] [numFrames]\n");
+        return -1;
+    }
+
+    int numChannels = numThreads * channelsPerThread;
+
+    MockParams params = mockGetParams();
+    params.numChannels = numChannels;
+    params.odMs = 0.5f;
+    params.parUsPerBox = 10.0f;
+    params.fdMs = 0.2f;
+    params.ccMs = 0.5f;
+    params.loadMs = 0.0f;
+    mockConfigure(params);
+
+    Config cfg;
+    vector<CInfo> refInfos;
+    if (!parseConfigAPI(cfg, refInfos, "config.json")) {
+        printf("mock_stress: initialization failed\n");
+        return -1;
+    }
+
+    cfg.engineCacheDir.clear();  // no engine files and no warm-up: only the inference calls are exercised
+    cfg.warmupRuns = 0;
+    if (!initModel(cfg)) {
+        printf("mock_stress: initialization failed\n");
+        return -1;
+    }
+
+    vector<CInfo> cInfos = refInfos, loopInfos = refInfos;  // same initial records for all runs
+    Mat frame = Mat::zeros(cfg.frameHeights[0], cfg.frameWidths[0], CV_8UC3);
+
+    // sequential reference
+    vector<vector<FrameResult>> expected(numChannels, vector<FrameResult>(numFrames));
+    for (int f = 0; f < numFrames; f++)
+        for (int vchID = 0; vchID < numChannels; vchID++)
+            runFrame(nullptr, refInfos[vchID], frame, vchID, f, cfg.odScoreTh, expected[vchID][f]);
+
+    destroyModel();  // reset the per-channel counters of the mock
+    if (!initModel(cfg)) {
+        printf("mock_stress: initialization failed\n");
+        return -1;
+    }
+
+    // concurrent run
+    atomic<int> mismatches{0}, failures{0};
+    vector<thread> threads;
+    steady_clock::time_point start = steady_clock::now();
+
+    for (int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            int first = t * channelsPerThread;
+            vector<InferContext> ctxs;
+
+            if (t % 2 == 0) {
+                for (int c = 0; c < channelsPerThread; c++)
+                    ctxs.push_back(createContext(first + c));
+            }
+            else {
+                ctxs.assign(channelsPerThread, createContext(-1));
+            }
+
+            Mat localFrame = frame.clone();
+            for (int f = 0; f < numFrames; f++) {
+                for (int c = 0; c < channelsPerThread; c++) {
+                    int vchID = first + c;
+                    FrameResult res;
+
+                    if (!runFrame(ctxs[c], cInfos[vchID], localFrame, vchID, f, cfg.odScoreTh, res))
+                        failures++;
+
+                    const FrameResult& exp = expected[vchID][f];
+                    if (res.odHash != exp.odHash || res.fdHash != exp.fdHash || res.ccHash != exp.ccHash)
+                        mismatches++;
+                }
+            }
+
+            if (t % 2 == 0) {
+                for (InferContext ctx : ctxs)
+                    destroyContext(ctx);
+            }
+            else {
+                destroyContext(ctxs[0]);
+            }
+        });
+    }
+
+    for (auto& th : threads)
+        th.join();
+
+    double sec = duration_cast<microseconds>(steady_clock::now() - start).count() / 1e6;
+    destroyModel();
+
+    printf("mock_stress: %d threads x %d channels x %d frames in %.2fs (%.1f frames/s), mismatches: %d, failures: %d\n",
+        numThreads, channelsPerThread, numFrames, sec, numChannels * numFrames / sec, mismatches.load(),
+        failures.load());
+
+    // coroutine run
+    if (!initModel(cfg)) {
+        printf("mock_stress: initialization failed\n");
+        return -1;
+    }
+
+    atomic<int> loopMismatches{0}, loopFailures{0}, running{numChannels};
+    InferLoop loop;
+    start = steady_clock::now();
+
+    for (int vchID = 0; vchID < numChannels; vchID++)
+        runChannel(loop, loopInfos[vchID], frame, vchID, numFrames, cfg.odScoreTh, expected[vchID], loopMismatches,
+            loopFailures, running);
+
+    threads.clear();
+    for (int t = 0; t < numThreads; t++)
+        threads.emplace_back([&]() { loop.run(); });
+
+    for (auto& th : threads)
+        th.join();
+
+    sec = duration_cast<microseconds>(steady_clock::now() - start).count() / 1e6;
+    destroyModel();
+
+    printf("mock_stress: %d channels x %d frames as coroutines on %d threads in %.2fs (%.1f frames/s), "
+           "mismatches: %d, failures: %d\n",
+        numChannels, numFrames, numThreads, sec, numChannels * numFrames / sec, loopMismatches.load(),
+        loopFailures.load());
+
+    mismatches += loopMismatches;
+    failures += loopFailures;
+    return (mismatches > 0 || failures > 0) ? 1 : 0;
+}
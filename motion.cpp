@@ -0,0 +1,91 @@
+#include "motion.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+using namespace std;
+using namespace cv;
+
+void MotionGate::init(const ODRecord& odRcd, int vchID, float _motionTh, int _maxSkip) {
+    motionTh = _motionTh;
+    maxSkip = std::max(_maxSkip, 1);
+
+    polys.clear();
+    lines.clear();
+    for (const Zone& zone : odRcd.zones)
+        if (zone.enabled && zone.vchID == vchID && zone.pts.size() > 2)
+            polys.push_back(zone.pts);
+
+    for (const CntLine& cntLine : odRcd.cntLines)
+        if (cntLine.enabled && cntLine.vchID == vchID)
+            lines.emplace_back(cntLine.pts[0], cntLine.pts[1]);
+
+    frameSize = Size();  // the mask and the background are rebuilt on the next frame
+    background.release();
+    motion = 0.0f;
+    skipCnt = 0;
+    skipped = 0;
+}
+
+bool MotionGate::update(const cv::Mat& frame) {
+    if (frame.empty())
+        return true;
+
+    Size smallSize(MOTION_WIDTH, std::max(frame.rows * MOTION_WIDTH / frame.cols, 1));
+    resize(frame, small, smallSize, 0, 0, INTER_AREA);
+    if (small.channels() == 3)
+        cvtColor(small, gray, COLOR_BGR2GRAY);
+    else
+        small.copyTo(gray);
+
+    if (frame.size() != frameSize || background.empty()) {  // first frame or new resolution: no reference yet
+        buildMask(frame.size(), smallSize);
+        gray.copyTo(background);
+        motion = 1.0f;
+        skipCnt = 0;
+        return true;
+    }
+
+    absdiff(gray, background, diff);
+    threshold(diff, diff, MOTION_PIXEL_TH, 255, THRESH_BINARY);
+    if (!mask.empty())
+        diff &= mask;
+
+    motion = maskArea > 0 ? (float)countNonZero(diff) / maskArea : 0.0f;
+    addWeighted(gray, MOTION_BG_ALPHA, background, 1.0 - MOTION_BG_ALPHA, 0, background);
+
+    if (motion >= motionTh || ++skipCnt >= maxSkip) {
+        skipCnt = 0;
+        return true;
+    }
+
+    skipped++;
+    return false;
+}
+
+void MotionGate::buildMask(cv::Size _frameSize, cv::Size smallSize) {
+    frameSize = _frameSize;
+
+    if (polys.empty() && lines.empty()) {
+        mask.release();
+        maskArea = smallSize.area();
+        return;
+    }
+
+    double sx = (double)smallSize.width / frameSize.width;
+    double sy = (double)smallSize.height / frameSize.height;
+    auto scale = [sx, sy](Point p) { return Point(cvRound(p.x * sx), cvRound(p.y * sy)); };
+
+    mask = Mat::zeros(smallSize, CV_8UC1);
+    for (auto& poly : polys) {
+        vector<Point> pts;
+        for (const Point& p : poly)
+            pts.push_back(scale(p));
+        fillPoly(mask, vector<vector<Point>>{pts}, Scalar(255));
+    }
+
+    int thickness = std::max(cvRound(2 * MOTION_LINE_MARGIN * sx), 1);
+    for (auto& [p0, p1] : lines)
+        line(mask, scale(p0), scale(p1), Scalar(255), thickness);
+
+    maskArea = countNonZero(mask);
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "global.h"
+
+#define MOTION_WIDTH 160       /// width of the downscaled gray frame (height keeps the aspect ratio)
+#define MOTION_PIXEL_TH 20     /// gray level difference from the background that makes a pixel moving
+#define MOTION_BG_ALPHA 0.05   /// update rate of the running-average background
+#define MOTION_LINE_MARGIN 48  /// half width(px, frame coordinates) of the gated band around a counting line
+
+/// @brief per-channel motion gate of object detection
+/// Each frame is downscaled to a MOTION_WIDTH gray image and compared with a running-average background inside the
+/// gated area: the union of the zones and counting lines of the channel (the whole frame when there are none). OD
+/// should run when the fraction of moving pixels reaches the threshold or after maxSkip skipped frames; otherwise the
+/// caller reuses the last dboxes. All image operations are OpenCV primitives with SIMD paths (resize with an integer
+/// INTER_AREA factor, cvtColor, absdiff, threshold, countNonZero).
+class MotionGate {
+   public:
+    /// (re)initialize the gate for the zones and counting lines of vchID in odRcd
+    void init(const ODRecord& odRcd, int vchID, float motionTh, int maxSkip);
+
+    /// feed a frame: true when OD should run on it
+    bool update(const cv::Mat& frame);
+
+    /// fraction of moving pixels in the gated area at the last update (0 - 1)
+    float getMotion() const {
+        return motion;
+    }
+
+    /// frames whose OD was skipped
+    uint64_t getSkipped() const {
+        return skipped;
+    }
+
+   private:
+    void buildMask(cv::Size frameSize, cv::Size smallSize);
+
+    std::vector<std::vector<cv::Point>> polys;           /// gated zones (frame coordinates)
+    std::vector<std::pair<cv::Point, cv::Point>> lines;  /// gated counting lines (frame coordinates)
+    float motionTh = 0.0f;
+    int maxSkip = 0;
+
+    cv::Size frameSize;   /// frame size the mask was built for
+    cv::Mat small, gray;  /// downscaled frame (reused)
+    cv::Mat background;   /// running average of gray
+    cv::Mat diff;         /// moving pixels (reused)
+    cv::Mat mask;         /// gated area (empty: whole frame)
+    int maskArea = 0;
+
+    float motion = 0.0f;
+    int skipCnt = 0;  /// frames skipped since the last OD
+    uint64_t skipped = 0;
+};
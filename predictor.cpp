@@ -0,0 +1,86 @@
+#include "predictor.hpp"
+
+#include <algorithm>
+
+using namespace std;
+
+void BoxPredictor::init(int _maxFrames) {
+    maxFrames = std::max(_maxFrames, 1);
+    tracks.clear();
+    corrected = false;
+}
+
+void BoxPredictor::correct(std::span<const DetBox> dboxes, uint frameCnt) {
+    next.clear();
+
+    for (const DetBox& dbox : dboxes) {
+        Track t{dbox, 0.0f, 0.0f, frameCnt};
+
+        auto it = lower_bound(tracks.begin(), tracks.end(), dbox.trackID,
+            [](const Track& tr, uint id) { return tr.box.trackID < id; });
+
+        if (dbox.trackID > 0 && it != tracks.end() && it->box.trackID == dbox.trackID && frameCnt > it->frameCnt) {
+            // known track: blend the measured velocity into the estimate
+            float dt = (float)(frameCnt - it->frameCnt);
+            t.vx = it->vx + PREDICT_VELOCITY_GAIN * ((dbox.rx - it->box.rx) / dt - it->vx);
+            t.vy = it->vy + PREDICT_VELOCITY_GAIN * ((dbox.ry - it->box.ry) / dt - it->vy);
+        }
+        else if (dbox.trackID > 0 && corrected && frameCnt > lastCorrect) {
+            // new track: rxP/ryP is its position at the previous OD run
+            float dt = (float)(frameCnt - lastCorrect);
+            t.vx = (dbox.rx - dbox.rxP) / dt;
+            t.vy = (dbox.ry - dbox.ryP) / dt;
+        }
+
+        next.push_back(t);
+    }
+
+    sort(next.begin(), next.end(), [](const Track& a, const Track& b) { return a.box.trackID < b.box.trackID; });
+    tracks.swap(next);
+
+    lastCorrect = frameCnt;
+    corrected = true;
+}
+
+int BoxPredictor::predict(std::span<DetBox> dboxes, uint frameCnt, cv::Size frameSize) const {
+    int n = 0;
+
+    for (const Track& t : tracks) {
+        if (n >= (int)dboxes.size())
+            break;
+
+        int dt = (int)(frameCnt - t.frameCnt);
+        if (dt < 0 || dt > maxFrames)
+            continue;
+
+        int dx = (int)lround(t.vx * dt), dy = (int)lround(t.vy * dt);
+        int dxP = (int)lround(t.vx * (dt - 1)), dyP = (int)lround(t.vy * (dt - 1));
+        if (t.box.trackID == 0)  // untracked: kept in place
+            dx = dy = dxP = dyP = 0;
+
+        DetBox& d = dboxes[n];
+        d = t.box;
+        d.x += dx;
+        d.y += dy;
+        d.rx += dx;
+        d.ry += dy;
+        d.rxP = t.box.rx + dxP;
+        d.ryP = t.box.ry + dyP;
+        d.frameCnt = frameCnt;
+
+        // clip to the frame (drop the track once it is outside)
+        int x0 = std::max(d.x, 0), y0 = std::max(d.y, 0);
+        int x1 = std::min(d.x + d.w, frameSize.width), y1 = std::min(d.y + d.h, frameSize.height);
+        if (x1 <= x0 || y1 <= y0)
+            continue;
+
+        d.onBoundary = x0 != d.x || y0 != d.y || x1 != d.x + d.w || y1 != d.y + d.h;
+        d.x = x0;
+        d.y = y0;
+        d.w = x1 - x0;
+        d.h = y1 - y0;
+        n++;
+    }
+
+    return n;
+}
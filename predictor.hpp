@@ -0,0 +1,38 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "global.h"
+
+#define PREDICT_VELOCITY_GAIN 0.5f  /// weight of a new velocity measurement (beta of the alpha-beta filter)
+
+/// @brief per-channel box predictor for frames without OD
+/// Keeps the boxes of the last OD run with a constant-velocity estimate per trackID (an alpha-beta filter, i.e. the
+/// steady-state Kalman filter of that model, on the reference point rx/ry). correct snaps every track back to its
+/// detection; predict extrapolates the tracks to a later frame (rxP/ryP: the extrapolated position one frame earlier).
+/// Tracks are extrapolated for at most maxFrames frames and dropped when they leave the frame, which bounds the error.
+class BoxPredictor {
+   public:
+    void init(int maxFrames);
+
+    /// update the tracks with the dboxes of an OD run on frameCnt (tracks missing from dboxes are dropped)
+    void correct(std::span<const DetBox> dboxes, uint frameCnt);
+
+    /// write the tracks extrapolated to frameCnt into dboxes and return their number
+    int predict(std::span<DetBox> dboxes, uint frameCnt, cv::Size frameSize) const;
+
+   private:
+    struct Track {
+        DetBox box;     /// box of the last detection
+        float vx, vy;   /// velocity of (rx, ry) in pixels per frame
+        uint frameCnt;  /// frame of the last detection
+    };
+
+    std::vector<Track> tracks, next;  /// sorted by trackID (next: reused buffer of correct)
+    int maxFrames = 30;
+    uint lastCorrect = 0;  /// frame of the last correct
+    bool corrected = false;
+};
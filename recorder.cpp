@@ -0,0 +1,157 @@
+#include "recorder.hpp"
+
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <iostream>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/videoio.hpp>
+
+using namespace std;
+using namespace cv;
+using namespace std::chrono;
+
+EventRecorder::~EventRecorder() {
+    stop();
+}
+
+bool EventRecorder::start(const Config& cfg) {
+    error_code ec;
+    filesystem::create_directories(cfg.clipDir, ec);
+    if (ec) {
+        cout << std::format("EventRecorder: cannot create {}\n", cfg.clipDir);
+        return false;
+    }
+
+    channels.clear();
+    channels.resize(cfg.numChannels);
+    for (int c = 0; c < cfg.numChannels; c++) {
+        Channel& ch = channels[c];
+        ch.fps = c < (int)cfg.fpss.size() && cfg.fpss[c] > 0 ? cfg.fpss[c] : 30.0f;
+        ch.ringSize = (size_t)std::max(cfg.clipPreSec * ch.fps, 0.0f);
+        ch.postFrames = std::max((int)(cfg.clipPostSec * ch.fps), 1);
+        ch.maxFrames = std::max((int)(cfg.clipMaxSec * ch.fps), (int)ch.ringSize + ch.postFrames);
+    }
+
+    clipDir = cfg.clipDir;
+    encodeParams = {IMWRITE_JPEG_QUALITY, cfg.clipJpegQuality};
+    maxConcurrent = std::max(cfg.clipMaxConcurrent, 1);
+    maxBytesPerSec = std::max(cfg.clipMaxMBps, 0.0f) * 1e6;
+
+    running = true;
+    writer = thread(&EventRecorder::writeClips, this);
+    return true;
+}
+
+void EventRecorder::stop() {
+    if (!writer.joinable())
+        return;
+
+    for (Channel& ch : channels)
+        if (ch.clip)
+            close(ch);
+
+    {
+        lock_guard<mutex> lock(m);
+        running = false;
+    }
+    cond.notify_one();
+    writer.join();
+}
+
+void EventRecorder::push(const cv::Mat& frame, int vchID) {
+    Channel& ch = channels[vchID];
+    if (ch.ringSize == 0 && !ch.clip)
+        return;
+
+    auto jpeg = make_shared<vector<uchar>>();
+    if (!imencode(".jpg", frame, *jpeg, encodeParams))
+        return;
+
+    if (ch.ringSize > 0) {
+        ch.ring.push_back(jpeg);
+        if (ch.ring.size() > ch.ringSize)
+            ch.ring.pop_front();
+    }
+
+    if (ch.clip) {
+        ch.clip->frames.push_back(std::move(jpeg));
+        if (--ch.postLeft <= 0 || (int)ch.clip->frames.size() >= ch.maxFrames)
+            close(ch);
+    }
+}
+
+int EventRecorder::trigger(int vchID, int event, uint frameCnt) {
+    static const char* names[NUM_EVENTS] = {"intrusion", "fire", "cclevel"};
+    Channel& ch = channels[vchID];
+
+    if (ch.clip) {
+        ch.postLeft = ch.postFrames;
+        return 0;
+    }
+
+    if (inFlight >= maxConcurrent) {
+        dropped++;
+        return -1;
+    }
+
+    inFlight++;
+    ch.clip = make_unique<Clip>();
+    ch.clip->file = std::format("{}ch{}_{:06}_{}.mp4", clipDir, vchID, frameCnt, names[event]);
+    ch.clip->fps = ch.fps;
+    ch.clip->frames.assign(ch.ring.begin(), ch.ring.end());
+    ch.postLeft = ch.postFrames;
+    return 1;
+}
+
+void EventRecorder::close(Channel& ch) {
+    {
+        lock_guard<mutex> lock(m);
+        queue.push_back(std::move(ch.clip));
+    }
+    cond.notify_one();
+}
+
+void EventRecorder::writeClips() {
+    while (1) {
+        unique_ptr<Clip> clip;
+        {
+            unique_lock<mutex> lock(m);
+            cond.wait(lock, [this] { return !queue.empty() || !running; });
+            if (queue.empty())
+                return;  // stopped and drained
+
+            clip = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        VideoWriter videoWriter;
+        steady_clock::time_point start = steady_clock::now();
+        double bytes = 0.0;
+
+        for (const Jpeg& jpeg : clip->frames) {
+            Mat frame = imdecode(*jpeg, IMREAD_COLOR);
+            if (frame.empty())
+                continue;
+
+            if (!videoWriter.isOpened() &&
+                !videoWriter.open(clip->file, VideoWriter::fourcc('m', 'p', '4', 'v'), clip->fps, frame.size())) {
+                cout << std::format("EventRecorder: cannot open {}\n", clip->file);
+                break;
+            }
+            videoWriter << frame;
+
+            // pace the writer: the compressed frames written so far at no more than maxBytesPerSec
+            bytes += jpeg->size();
+            if (maxBytesPerSec > 0)
+                this_thread::sleep_until(start + microseconds((int64_t)(bytes / maxBytesPerSec * 1e6)));
+        }
+
+        if (videoWriter.isOpened()) {
+            videoWriter.release();
+            written++;
+        }
+        inFlight--;
+    }
+}
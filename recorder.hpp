@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "global.h"
+
+/// EVENT (triggers of EventRecorder)
+#define EVENT_INTRUSION 0  /// people in a zone with isMode == IS_RESTRICTED_AREA
+#define EVENT_FIRE 1       /// fire or smoke probability above fdScoreThFire or fdScoreThSmoke
+#define EVENT_CC_LEVEL 2   /// ccLevel of a CCZone changed
+#define NUM_EVENTS 3
+
+/// @brief event-triggered clip recorder
+/// Every channel keeps a ring of its last clipPreSec seconds as JPEG frames (a few percent of the raw size). A trigger
+/// starts a clip with that pre-roll; the following frames are added until clipPostSec seconds after the last trigger
+/// (at most clipMaxSec in total). Completed clips are decoded and written to clipDir by a background thread, paced to
+/// clipMaxMBps, so the frame loop only pays for the JPEG encoding. At most clipMaxConcurrent clips are in flight
+/// (collecting or waiting for the writer); triggers beyond that are dropped.
+/// push and trigger are called from the frame loop (one thread).
+class EventRecorder {
+   public:
+    ~EventRecorder();
+
+    /// create clipDir and start the writer thread (call after VideoStreamer set the fps of the channels)
+    bool start(const Config& cfg);
+
+    /// close the open clips, write everything queued and stop the writer thread
+    void stop();
+
+    /// add a frame of vchID to its ring (and to its open clip): JPEG-encodes the frame on the calling thread
+    void push(const cv::Mat& frame, int vchID);
+
+    /// trigger a clip of vchID: 1 new clip, 0 the open clip is extended, -1 dropped (too many clips in flight)
+    int trigger(int vchID, int event, uint frameCnt);
+
+    /// clips written
+    uint64_t getWritten() const {
+        return written;
+    }
+
+    /// triggers dropped because of clipMaxConcurrent
+    uint64_t getDropped() const {
+        return dropped;
+    }
+
+   private:
+    typedef std::shared_ptr<const std::vector<uchar>> Jpeg;  /// shared by the ring and the clips
+
+    struct Clip {
+        std::string file;
+        float fps;
+        std::vector<Jpeg> frames;
+    };
+
+    struct Channel {
+        std::deque<Jpeg> ring;  /// pre-roll
+        size_t ringSize = 0;    /// frames of the pre-roll
+        int postFrames = 0;     /// frames of the post-roll
+        int maxFrames = 0;      /// frames of a clip
+        float fps = 0.0f;
+        std::unique_ptr<Clip> clip;  /// open clip (nullptr: none)
+        int postLeft = 0;            /// frames until the open clip is closed
+    };
+
+    void close(Channel& ch);
+    void writeClips();
+
+    std::vector<Channel> channels;
+    std::string clipDir;
+    std::vector<int> encodeParams;
+    int maxConcurrent = 1;
+    double maxBytesPerSec = 0.0;  /// disk bandwidth of the writer (0: unlimited)
+
+    std::thread writer;
+    std::mutex m;
+    std::condition_variable cond;
+    std::deque<std::unique_ptr<Clip>> queue;  /// closed clips (guarded by m)
+    bool running = false;                     /// guarded by m
+
+    std::atomic<int> inFlight{0};
+    std::atomic<uint64_t> written{0};
+    uint64_t dropped = 0;
+};
@@ -0,0 +1,223 @@
+#include "replay.hpp"
+
+#include <cstring>
+
+#include <opencv2/imgproc.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace cv;
+
+/// payload bytes of a frame (BGR: width * height * 3, NV12: width * height * 3 / 2)
+static uint64_t frameBytesOf(int width, int height, int pixFmt) {
+    return (uint64_t)width * height * (pixFmt == PIX_FMT_BGR ? 3 : 1) +
+           (pixFmt == PIX_FMT_NV12 ? (uint64_t)width * height / 2 : 0);
+}
+
+ReplayWriter::~ReplayWriter() {
+    close();
+}
+
+bool ReplayWriter::open(const std::string& filename, int width, int height, int pixFmt, float fps) {
+    close();
+
+    if (width <= 0 || height <= 0 || (pixFmt != PIX_FMT_BGR && pixFmt != PIX_FMT_NV12) ||
+        (pixFmt == PIX_FMT_NV12 && (width % 2 || height % 2)))
+        return false;
+
+    file = fopen(filename.c_str(), "wb");
+    if (!file)
+        return false;
+
+    header = ReplayHeader{};
+    memcpy(header.magic, REPLAY_MAGIC, 4);
+    header.version = REPLAY_VERSION;
+    header.headerSize = sizeof(ReplayHeader);
+    header.width = width;
+    header.height = height;
+    header.pixFmt = pixFmt;
+    header.fps = fps;
+    header.frameBytes = frameBytesOf(width, height, pixFmt);
+
+    offsets.clear();
+    offset = fwrite(&header, 1, sizeof(header), file);  // patched by close
+    return offset == sizeof(header) && pad();
+}
+
+bool ReplayWriter::write(const cv::Mat& frame) {
+    if (!file || frame.type() != CV_8UC3 || frame.cols != header.width || frame.rows != header.height)
+        return false;
+
+    offsets.push_back(offset);
+
+    const Mat* payload = &frame;
+    if (header.pixFmt == PIX_FMT_NV12) {
+        // I420 -> NV12: the Y plane as is, then U and V interleaved
+        cvtColor(frame, i420, COLOR_BGR2YUV_I420);
+        nv12.create(header.height * 3 / 2, header.width, CV_8UC1);
+        i420.rowRange(0, header.height).copyTo(nv12.rowRange(0, header.height));
+
+        const uchar* u = i420.ptr<uchar>(header.height);
+        const uchar* v = u + (size_t)header.width * header.height / 4;
+        uchar* uv = nv12.ptr<uchar>(header.height);
+        for (size_t i = 0; i < (size_t)header.width * header.height / 4; i++) {
+            uv[2 * i] = u[i];
+            uv[2 * i + 1] = v[i];
+        }
+        payload = &nv12;
+    }
+
+    size_t rowBytes = payload->cols * payload->elemSize();
+    for (int r = 0; r < payload->rows; r++)
+        if (fwrite(payload->ptr(r), 1, rowBytes, file) != rowBytes)
+            return false;
+
+    offset += header.frameBytes;
+    return pad();
+}
+
+bool ReplayWriter::close() {
+    if (!file)
+        return false;
+
+    header.numFrames = (uint32_t)offsets.size();
+    header.indexOffset = offset;
+    bool ok = fwrite(offsets.data(), sizeof(uint64_t), offsets.size(), file) == offsets.size();
+    ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, 1, sizeof(header), file) == sizeof(header);
+
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+bool ReplayWriter::pad() {
+    static const char zeros[REPLAY_ALIGN] = {};
+    size_t n = (REPLAY_ALIGN - offset % REPLAY_ALIGN) % REPLAY_ALIGN;
+    offset += n;
+    return fwrite(zeros, 1, n, file) == n;
+}
+
+ReplayReader::~ReplayReader() {
+    close();
+}
+
+bool ReplayReader::open(const std::string& filename) {
+    close();
+
+#ifdef _WIN32
+    HANDLE fh = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fh == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fh, &fileSize);
+    HANDLE mh = fileSize.QuadPart > 0 ? CreateFileMappingA(fh, nullptr, PAGE_WRITECOPY, 0, 0, nullptr) : nullptr;
+    if (!mh) {
+        CloseHandle(fh);
+        return false;
+    }
+
+    fileHandle = fh;
+    mapHandle = mh;
+    length = (size_t)fileSize.QuadPart;
+    data = (uint8_t*)MapViewOfFile(mh, FILE_MAP_COPY, 0, 0, 0);
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // private writable mapping: pages are shared with the page cache until a caller draws on a frame
+    void* p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED)
+        return false;
+
+    madvise(p, st.st_size, MADV_SEQUENTIAL);
+    data = (uint8_t*)p;
+    length = st.st_size;
+#endif
+
+    if (!data || length < sizeof(ReplayHeader)) {
+        close();
+        return false;
+    }
+
+    // the sizes are compared by subtraction from length, so corrupt offsets cannot wrap around
+    memcpy(&header, data, sizeof(header));
+    bool nv12 = header.pixFmt == PIX_FMT_NV12;
+    bool ok = memcmp(header.magic, REPLAY_MAGIC, 4) == 0 && header.version <= REPLAY_VERSION &&
+              (header.pixFmt == PIX_FMT_BGR || nv12) && header.width > 0 && header.height > 0 &&
+              (!nv12 || (header.width % 2 == 0 && header.height % 2 == 0)) &&
+              header.frameBytes == frameBytesOf(header.width, header.height, header.pixFmt) &&
+              header.numFrames > 0 && header.indexOffset >= sizeof(ReplayHeader) && header.indexOffset <= length &&
+              header.numFrames <= (length - header.indexOffset) / sizeof(uint64_t);
+    if (!ok) {
+        close();  // also an unfinished file (close was never called: numFrames and indexOffset are still 0)
+        return false;
+    }
+
+    offsets.resize(header.numFrames);
+    memcpy(offsets.data(), data + header.indexOffset, header.numFrames * sizeof(uint64_t));
+    for (uint64_t o : offsets) {
+        if (o < sizeof(ReplayHeader) || o > length || header.frameBytes > length - o) {
+            close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ReplayReader::close() {
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapHandle)
+        CloseHandle(mapHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+    fileHandle = mapHandle = nullptr;
+#else
+    if (data)
+        munmap(data, length);
+#endif
+
+    data = nullptr;
+    length = 0;
+    offsets.clear();
+}
+
+FrameView ReplayReader::view(size_t i) const {
+    uint8_t* p = data + offsets[i];
+    int w = header.width, h = header.height;
+
+    if (header.pixFmt == PIX_FMT_NV12)
+        return FrameView::fromNV12(p, w, p + (size_t)w * h, w, w, h, i + 1);
+    return FrameView::fromBGR(p, (size_t)w * 3, w, h, i + 1);
+}
+
+cv::Mat ReplayReader::read(size_t i, cv::Mat& buf) const {
+    return view(i).toBGR(buf);
+}
+
+void ReplayReader::release(size_t i) {
+#ifndef _WIN32
+    if (i < offsets.size())
+        madvise(data + offsets[i], (header.frameBytes + REPLAY_ALIGN - 1) / REPLAY_ALIGN * REPLAY_ALIGN, MADV_DONTNEED);
+#endif
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "global.h"
+
+#define REPLAY_MAGIC "INRF"  /// file magic
+#define REPLAY_VERSION 1     /// format version (readers reject files of a newer version)
+#define REPLAY_ALIGN 4096    /// frame payloads start on page boundaries
+#define REPLAY_EXT ".rpl"    /// inputs with this extension are read by ReplayReader (see VideoStreamer)
+
+/// file header (little endian, fixed size)
+struct ReplayHeader {
+    char magic[4];        /// REPLAY_MAGIC
+    uint16_t version;     /// REPLAY_VERSION
+    uint16_t headerSize;  /// sizeof(ReplayHeader)
+    int32_t width;
+    int32_t height;
+    int32_t pixFmt;  /// PIX_FMT_BGR or PIX_FMT_NV12
+    float fps;
+    uint32_t numFrames;
+    uint32_t reserved;
+    uint64_t frameBytes;   /// payload bytes of a frame (BGR: width * height * 3, NV12: width * height * 3 / 2)
+    uint64_t indexOffset;  /// offset of the numFrames uint64_t payload offsets
+    uint64_t reserved2[2];
+};
+
+static_assert(sizeof(ReplayHeader) == 64, "the replay layout is part of the format");
+
+/// @brief writer of a raw replay file
+/// Frames are stored uncompressed (BGR, or NV12 at half the size), each on a REPLAY_ALIGN boundary, followed by the
+/// table of frame offsets; close patches the header. Convert a video once with tools/video2replay.
+class ReplayWriter {
+   public:
+    ReplayWriter() = default;
+    ReplayWriter(const ReplayWriter&) = delete;
+    ReplayWriter& operator=(const ReplayWriter&) = delete;
+    ~ReplayWriter();
+
+    /// width and height should be even for PIX_FMT_NV12
+    bool open(const std::string& filename, int width, int height, int pixFmt, float fps);
+
+    /// append a BGR frame of the open size
+    bool write(const cv::Mat& frame);
+
+    /// write the offset table and the header
+    bool close();
+
+   private:
+    bool pad();
+
+    FILE* file = nullptr;
+    ReplayHeader header{};
+    uint64_t offset = 0;  /// current file offset
+    std::vector<uint64_t> offsets;
+    cv::Mat i420, nv12;  /// conversion buffers (reused)
+};
+
+/// @brief memory-mapped reader of a raw replay file
+/// A frame is a view into the mapping: read returns a zero-copy BGR Mat for PIX_FMT_BGR files (NV12 is converted into
+/// the caller's buffer), so replaying costs no decoding and no copy. The mapping is private (copy-on-write): drawing on
+/// a returned frame only copies the touched pages and never changes the file.
+class ReplayReader {
+   public:
+    ReplayReader() = default;
+    ReplayReader(const ReplayReader&) = delete;
+    ReplayReader& operator=(const ReplayReader&) = delete;
+    ~ReplayReader();
+
+    bool open(const std::string& filename);
+    void close();
+
+    bool isOpen() const {
+        return data != nullptr;
+    }
+
+    const ReplayHeader& getHeader() const {
+        return header;
+    }
+
+    /// number of frames
+    size_t size() const {
+        return offsets.size();
+    }
+
+    /// non-owning view of frame i in the mapping (valid until close)
+    FrameView view(size_t i) const;
+
+    /// BGR frame i: a view of the mapping (PIX_FMT_BGR) or converted into buf (PIX_FMT_NV12)
+    cv::Mat read(size_t i, cv::Mat& buf) const;
+
+    /// drop the pages of frame i copied by writes (drawing), so long replays do not accumulate private copies; views
+    /// of the frame show the file content again
+    void release(size_t i);
+
+   private:
+    uint8_t* data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mapHandle = nullptr;
+#endif
+
+    ReplayHeader header{};
+    std::vector<uint64_t> offsets;
+};
@@ -0,0 +1,505 @@
+#include "resultlog.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+void putUint(vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+void putInt(vector<uint8_t>& out, int64_t v) {
+    putUint(out, ((uint64_t)v << 1) ^ (uint64_t)(v >> 63));  // zigzag: small magnitudes stay short
+}
+
+void putProb(vector<uint8_t>& out, float p) {
+    uint16_t q = (uint16_t)std::lround(std::clamp(p, 0.0f, 1.0f) * 65535.0f);
+    out.push_back((uint8_t)q);
+    out.push_back((uint8_t)(q >> 8));
+}
+
+template <typename T>
+void putRaw(vector<uint8_t>& out, const T& v) {
+    const uint8_t* p = (const uint8_t*)&v;
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+/// bounds-checked payload decoder (ok turns false on the first overrun)
+struct Decoder {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+
+    uint64_t getUint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (p >= end)
+                break;
+            uint8_t b = *p++;
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                return v;
+        }
+        ok = false;
+        return 0;
+    }
+
+    int64_t getInt() {
+        uint64_t v = getUint();
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+
+    float getProb() {
+        if (end - p < 2) {
+            ok = false;
+            return 0.0f;
+        }
+        uint16_t q = (uint16_t)(p[0] | (p[1] << 8));
+        p += 2;
+        return q / 65535.0f;
+    }
+
+    uint8_t getByte() {
+        if (p >= end) {
+            ok = false;
+            return 0;
+        }
+        return *p++;
+    }
+};
+
+}  // namespace
+
+ResultLogWriter::~ResultLogWriter() {
+    close();
+}
+
+bool ResultLogWriter::open(const std::string& filename, int _vchID, int frameWidth, int frameHeight, float fps) {
+    close();
+
+    file = fopen(filename.c_str(), "wb");
+    if (!file)
+        return false;
+
+    vchID = _vchID;
+    buffer.clear();
+    buffer.reserve(RLOG_FLUSH_BYTES * 2);
+    index.clear();
+    lastIndex = 0;
+    offset = 0;
+
+    ResultLogHeader header{};
+    memcpy(header.magic, RLOG_MAGIC, 4);
+    header.version = RLOG_VERSION;
+    header.headerSize = sizeof(ResultLogHeader);
+    header.vchID = vchID;
+    header.frameWidth = frameWidth;
+    header.frameHeight = frameHeight;
+    header.fps = fps;
+    putRaw(buffer, header);
+    offset = buffer.size();
+
+    return true;
+}
+
+void ResultLogWriter::append(uint frameCnt, std::span<const DetBox> dboxes, bool withAtts, const FDRecord* fdRcd,
+    const CCRecord* ccRcd, const ODRecord* odRcd) {
+    if (!file)
+        return;
+
+    int flags = 0;
+    payload.clear();
+
+    if (odRcd) {
+        flags |= RLOG_HAS_OD | (withAtts ? RLOG_HAS_ATTS : 0);
+        putUint(payload, dboxes.size());
+
+        int64_t px = 0, py = 0, pt = 0;
+        for (const DetBox& dbox : dboxes) {
+            putInt(payload, (int64_t)dbox.trackID - pt);
+            putInt(payload, dbox.x - px);
+            putInt(payload, dbox.y - py);
+            putUint(payload, std::max(dbox.w, 0));
+            putUint(payload, std::max(dbox.h, 0));
+            putInt(payload, dbox.rx - (dbox.x + dbox.w / 2));  // 0 for the usual bottom-center reference point
+            putInt(payload, dbox.ry - (dbox.y + dbox.h));
+            putUint(payload, std::max(dbox.objID, 0));
+            putProb(payload, dbox.prob);
+
+            if (withAtts)
+                for (int a = 0; a < NUM_ATTRIBUTES; a++)
+                    payload.push_back((uint8_t)std::lround(std::clamp(dbox.patts.atts[a], 0.0f, 1.0f) * 255.0f));
+
+            pt = dbox.trackID;
+            px = dbox.x;
+            py = dbox.y;
+        }
+    }
+
+    if (fdRcd && !fdRcd->fireProbs.empty() && !fdRcd->smokeProbs.empty()) {
+        flags |= RLOG_HAS_FD;
+        putProb(payload, fdRcd->fireProbs.back());
+        putProb(payload, fdRcd->smokeProbs.back());
+    }
+
+    if (ccRcd) {
+        flags |= RLOG_HAS_CC;
+        putUint(payload, ccRcd->ccZones.size());
+        for (const CCZone& ccZone : ccRcd->ccZones) {
+            putInt(payload, ccZone.ccNums.empty() ? 0 : ccZone.ccNums.back());
+            putInt(payload, ccZone.ccLevel);
+        }
+    }
+
+    if (odRcd) {
+        flags |= RLOG_HAS_COUNTERS;
+
+        auto sum = [](const int (&counts)[NUM_GENDERS][NUM_AGE_GROUPS]) {
+            int total = 0;
+            for (int g = 0; g < NUM_GENDERS; g++)
+                for (int a = 0; a < NUM_AGE_GROUPS; a++)
+                    total += counts[g][a];
+            return total;
+        };
+
+        size_t numZones = std::count_if(odRcd->zones.begin(), odRcd->zones.end(),
+            [this](const Zone& zone) { return zone.vchID == vchID; });
+        putUint(payload, numZones);
+        for (const Zone& zone : odRcd->zones) {
+            if (zone.vchID != vchID)
+                continue;
+            putInt(payload, zone.zoneID);
+            putInt(payload, sum(zone.curPeople));
+            putInt(payload, sum(zone.hitMap));
+        }
+
+        size_t numLines = std::count_if(odRcd->cntLines.begin(), odRcd->cntLines.end(),
+            [this](const CntLine& cntLine) { return cntLine.vchID == vchID; });
+        putUint(payload, numLines);
+        for (const CntLine& cntLine : odRcd->cntLines) {
+            if (cntLine.vchID != vchID)
+                continue;
+            putInt(payload, cntLine.clineID);
+            putInt(payload, sum(cntLine.totalUL));
+            putInt(payload, sum(cntLine.totalDR));
+        }
+    }
+
+    ResultRecordHeader rec{};
+    rec.size = (uint32_t)payload.size();
+    rec.frameCnt = frameCnt;
+    rec.timeUs = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    rec.type = RLOG_REC_FRAME;
+    rec.flags = (uint8_t)flags;
+
+    index.emplace_back(frameCnt, offset);
+    putRaw(buffer, rec);
+    buffer.insert(buffer.end(), payload.begin(), payload.end());
+    offset += sizeof(rec) + payload.size();
+
+    if (index.size() >= RLOG_INDEX_PERIOD)
+        writeIndex();
+    if (buffer.size() >= RLOG_FLUSH_BYTES)
+        flush();
+}
+
+void ResultLogWriter::writeIndex() {
+    payload.clear();
+    putUint(payload, lastIndex);
+
+    uint prevFrameCnt = 0;
+    uint64_t prevOffset = 0;
+    for (auto& [frameCnt, frameOffset] : index) {
+        putInt(payload, (int64_t)frameCnt - prevFrameCnt);
+        putUint(payload, frameOffset - prevOffset);
+        prevFrameCnt = frameCnt;
+        prevOffset = frameOffset;
+    }
+
+    ResultRecordHeader rec{};
+    rec.size = (uint32_t)payload.size();
+    rec.frameCnt = (uint32_t)index.size();
+    rec.type = RLOG_REC_INDEX;
+
+    lastIndex = offset;
+    putRaw(buffer, rec);
+    buffer.insert(buffer.end(), payload.begin(), payload.end());
+    offset += sizeof(rec) + payload.size();
+    index.clear();
+}
+
+void ResultLogWriter::flush() {
+    if (file && !buffer.empty())
+        fwrite(buffer.data(), 1, buffer.size(), file);
+    buffer.clear();
+}
+
+void ResultLogWriter::close() {
+    if (!file)
+        return;
+
+    writeIndex();
+
+    ResultLogFooter footer{};
+    footer.lastIndex = lastIndex;
+    memcpy(footer.magic, RLOG_INDEX_MAGIC, 4);
+    putRaw(buffer, footer);
+
+    flush();
+    fclose(file);
+    file = nullptr;
+}
+
+ResultLogReader::~ResultLogReader() {
+    close();
+}
+
+bool ResultLogReader::open(const std::string& filename) {
+    close();
+
+#ifdef _WIN32
+    HANDLE fh = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fh == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fh, &fileSize);
+    HANDLE mh = fileSize.QuadPart > 0 ? CreateFileMappingA(fh, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    if (!mh) {
+        CloseHandle(fh);
+        return false;
+    }
+
+    fileHandle = fh;
+    mapHandle = mh;
+    length = (size_t)fileSize.QuadPart;
+    data = (const uint8_t*)MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+#else
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // the mapping keeps the file
+    if (p == MAP_FAILED)
+        return false;
+
+    data = (const uint8_t*)p;
+    length = st.st_size;
+#endif
+
+    if (!data || length < sizeof(ResultLogHeader)) {
+        close();
+        return false;
+    }
+
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, RLOG_MAGIC, 4) != 0 || header.version > RLOG_VERSION ||
+        header.headerSize < sizeof(ResultLogHeader) || header.headerSize > length) {
+        close();
+        return false;
+    }
+
+    if (!indexFromFooter())
+        indexFromRecords();
+
+    return true;
+}
+
+void ResultLogReader::close() {
+#ifdef _WIN32
+    if (data)
+        UnmapViewOfFile(data);
+    if (mapHandle)
+        CloseHandle(mapHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+    fileHandle = mapHandle = nullptr;
+#else
+    if (data)
+        munmap((void*)data, length);
+#endif
+
+    data = nullptr;
+    length = 0;
+    frames.clear();
+}
+
+bool ResultLogReader::indexFromFooter() {
+    if (length < header.headerSize + sizeof(ResultLogFooter))
+        return false;
+
+    ResultLogFooter footer;
+    memcpy(&footer, data + length - sizeof(footer), sizeof(footer));
+    if (memcmp(footer.magic, RLOG_INDEX_MAGIC, 4) != 0)
+        return false;
+
+    // follow the chain of index records from the last one, then put the blocks in file order
+    vector<vector<pair<uint, uint64_t>>> blocks;
+    uint64_t at = footer.lastIndex;
+    while (at != 0) {
+        if (at < header.headerSize || at + sizeof(ResultRecordHeader) > length)
+            return false;
+
+        ResultRecordHeader rec;
+        memcpy(&rec, data + at, sizeof(rec));
+        if (rec.type != RLOG_REC_INDEX || at + sizeof(rec) + rec.size > length)
+            return false;
+
+        Decoder dec{data + at + sizeof(rec), data + at + sizeof(rec) + rec.size};
+        uint64_t prevIndex = dec.getUint();
+
+        vector<pair<uint, uint64_t>>& block = blocks.emplace_back();
+        int64_t frameCnt = 0;
+        uint64_t offset = 0;
+        for (uint32_t i = 0; i < rec.frameCnt && dec.ok; i++) {
+            frameCnt += dec.getInt();
+            offset += dec.getUint();
+            block.emplace_back((uint)frameCnt, offset);
+        }
+        if (!dec.ok || prevIndex >= at)
+            return false;
+
+        at = prevIndex;
+    }
+
+    frames.clear();
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it)
+        frames.insert(frames.end(), it->begin(), it->end());
+    return true;
+}
+
+void ResultLogReader::indexFromRecords() {
+    frames.clear();
+
+    size_t at = header.headerSize;
+    while (at + sizeof(ResultRecordHeader) <= length) {
+        ResultRecordHeader rec;
+        memcpy(&rec, data + at, sizeof(rec));
+        if ((rec.type != RLOG_REC_FRAME && rec.type != RLOG_REC_INDEX) || at + sizeof(rec) + rec.size > length)
+            break;  // footer or truncated record
+
+        if (rec.type == RLOG_REC_FRAME)
+            frames.emplace_back(rec.frameCnt, at);
+        at += sizeof(rec) + rec.size;
+    }
+}
+
+bool ResultLogReader::read(size_t i, ResultFrame& frame) const {
+    if (i >= frames.size())
+        return false;
+
+    uint64_t at = frames[i].second;
+    if (at + sizeof(ResultRecordHeader) > length)
+        return false;
+
+    ResultRecordHeader rec;
+    memcpy(&rec, data + at, sizeof(rec));
+    if (rec.type != RLOG_REC_FRAME || at + sizeof(rec) + rec.size > length)
+        return false;
+
+    Decoder dec{data + at + sizeof(rec), data + at + sizeof(rec) + rec.size};
+    frame.frameCnt = rec.frameCnt;
+    frame.timeUs = rec.timeUs;
+    frame.flags = rec.flags;
+    frame.dboxes.clear();
+    frame.fireProb = frame.smokeProb = 0.0f;
+    frame.ccZones.clear();
+    frame.zones.clear();
+    frame.lines.clear();
+
+    if (rec.flags & RLOG_HAS_OD) {
+        uint64_t n = dec.getUint();
+        frame.dboxes.reserve(std::min<uint64_t>(n, rec.size));
+
+        int64_t px = 0, py = 0, pt = 0;
+        for (uint64_t b = 0; b < n && dec.ok; b++) {
+            DetBox dbox{};
+            dbox.trackID = (uint)(pt += dec.getInt());
+            dbox.x = (int)(px += dec.getInt());
+            dbox.y = (int)(py += dec.getInt());
+            dbox.w = (int)dec.getUint();
+            dbox.h = (int)dec.getUint();
+            dbox.rx = dbox.x + dbox.w / 2 + (int)dec.getInt();
+            dbox.ry = dbox.y + dbox.h + (int)dec.getInt();
+            dbox.objID = (int)dec.getUint();
+            dbox.prob = dec.getProb();
+            dbox.vchID = header.vchID;
+            dbox.frameCnt = rec.frameCnt;
+
+            if (rec.flags & RLOG_HAS_ATTS)
+                for (int a = 0; a < NUM_ATTRIBUTES; a++)
+                    dbox.patts.atts[a] = dec.getByte() / 255.0f;
+
+            frame.dboxes.push_back(dbox);
+        }
+    }
+
+    if (rec.flags & RLOG_HAS_FD) {
+        frame.fireProb = dec.getProb();
+        frame.smokeProb = dec.getProb();
+    }
+
+    if (rec.flags & RLOG_HAS_CC) {
+        uint64_t n = dec.getUint();
+        for (uint64_t z = 0; z < n && dec.ok; z++) {
+            int ccNum = (int)dec.getInt();
+            int ccLevel = (int)dec.getInt();
+            frame.ccZones.emplace_back(ccNum, ccLevel);
+        }
+    }
+
+    if (rec.flags & RLOG_HAS_COUNTERS) {
+        uint64_t n = dec.getUint();
+        for (uint64_t z = 0; z < n && dec.ok; z++) {
+            ResultFrame::ZoneCount zone;
+            zone.zoneID = (int)dec.getInt();
+            zone.current = (int)dec.getInt();
+            zone.total = (int)dec.getInt();
+            frame.zones.push_back(zone);
+        }
+
+        n = dec.getUint();
+        for (uint64_t l = 0; l < n && dec.ok; l++) {
+            ResultFrame::LineCount line;
+            line.clineID = (int)dec.getInt();
+            line.totalUL = (int)dec.getInt();
+            line.totalDR = (int)dec.getInt();
+            frame.lines.push_back(line);
+        }
+    }
+
+    return dec.ok;
+}
+
+size_t ResultLogReader::find(uint frameCnt) const {
+    auto it = std::lower_bound(frames.begin(), frames.end(), frameCnt,
+        [](const pair<uint, uint64_t>& f, uint cnt) { return f.first < cnt; });
+    return it - frames.begin();
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "global.h"
+
+#define RLOG_MAGIC "INRL"        /// file magic
+#define RLOG_INDEX_MAGIC "INRX"  /// footer magic (the file was closed cleanly)
+#define RLOG_VERSION 1           /// format version (readers reject files of a newer version)
+#define RLOG_INDEX_PERIOD 256    /// frame records between two index records
+#define RLOG_FLUSH_BYTES 65536   /// buffered bytes written at once
+
+/// RLOG_REC (record types)
+#define RLOG_REC_FRAME 1  /// results of one frame
+#define RLOG_REC_INDEX 2  /// (frameCnt, offset) of the frame records since the previous index record
+
+/// RLOG_HAS (sections of a frame record)
+#define RLOG_HAS_OD 0x01        /// dboxes
+#define RLOG_HAS_ATTS 0x02      /// PAR attributes of the dboxes
+#define RLOG_HAS_FD 0x04        /// last fire and smoke probabilities
+#define RLOG_HAS_CC 0x08        /// last ccNum and ccLevel of each CCZone
+#define RLOG_HAS_COUNTERS 0x10  /// zone and counting line counters
+
+/// file header (little endian, fixed size)
+struct ResultLogHeader {
+    char magic[4];        /// RLOG_MAGIC
+    uint16_t version;     /// RLOG_VERSION
+    uint16_t headerSize;  /// sizeof(ResultLogHeader)
+    int32_t vchID;
+    int32_t frameWidth;
+    int32_t frameHeight;
+    float fps;
+    uint32_t reserved[2];
+};
+
+/// record header (fixed size, followed by size bytes of payload)
+struct ResultRecordHeader {
+    uint32_t size;      /// payload bytes
+    uint32_t frameCnt;  /// frame record: frameCnt of the frame, index record: number of entries
+    int64_t timeUs;     /// frame record: system time of the frame (us since epoch)
+    uint8_t type;       /// RLOG_REC_FRAME or RLOG_REC_INDEX
+    uint8_t flags;      /// RLOG_HAS_* of a frame record
+    uint16_t reserved;
+    uint32_t reserved2;
+};
+
+/// footer of a cleanly closed file (fixed size, at the end)
+struct ResultLogFooter {
+    uint64_t lastIndex;  /// offset of the last index record
+    char magic[4];       /// RLOG_INDEX_MAGIC
+    uint32_t reserved;
+};
+
+static_assert(sizeof(ResultLogHeader) == 32 && sizeof(ResultRecordHeader) == 24 && sizeof(ResultLogFooter) == 16,
+    "the result log layout is part of the format");
+
+/// decoded frame record
+struct ResultFrame {
+    struct ZoneCount {
+        int zoneID;
+        int current;  /// people in the zone (Zone::getTotal)
+        int total;    /// hitMap total
+    };
+
+    struct LineCount {
+        int clineID;
+        int totalUL, totalDR;
+    };
+
+    uint frameCnt;
+    int64_t timeUs;
+    int flags;  /// RLOG_HAS_*
+
+    std::vector<DetBox> dboxes;  /// (only the logged fields are set)
+    float fireProb, smokeProb;
+    std::vector<std::pair<int, int>> ccZones;  /// (ccNum, ccLevel) of each CCZone
+    std::vector<ZoneCount> zones;
+    std::vector<LineCount> lines;
+};
+
+/// @brief per-channel result sink in a compact, versioned binary format
+/// Every frame is one record: a fixed ResultRecordHeader and a payload of varints. Box coordinates are zigzag deltas to
+/// the previous box of the frame (rx/ry to the bottom center of the box), probabilities are 16-bit fixed point and PAR
+/// attributes 8-bit. Every RLOG_INDEX_PERIOD frames an index record lists the offsets of the frames before it (and
+/// the previous index record), and close writes a footer pointing at the last index. Records are appended to a buffer
+/// written RLOG_FLUSH_BYTES at a time, so a frame costs no system call.
+class ResultLogWriter {
+   public:
+    ~ResultLogWriter();
+
+    bool open(const std::string& filename, int vchID, int frameWidth, int frameHeight, float fps);
+
+    /// append the results of a frame: dboxes and counters of odRcd (nullptr: no OD on the channel), the last
+    /// probabilities of fdRcd and the last counts of ccRcd (nullptr: no such section)
+    void append(uint frameCnt, std::span<const DetBox> dboxes, bool withAtts, const FDRecord* fdRcd,
+        const CCRecord* ccRcd, const ODRecord* odRcd);
+
+    /// write the buffer, the last index and the footer
+    void close();
+
+    bool isOpen() const {
+        return file != nullptr;
+    }
+
+   private:
+    void writeIndex();
+    void flush();
+
+    FILE* file = nullptr;
+    int vchID = 0;
+    std::vector<uint8_t> buffer;
+    std::vector<uint8_t> payload;  /// payload of the record being encoded (reused)
+    uint64_t offset = 0;           /// file offset of the end of buffer
+
+    std::vector<std::pair<uint, uint64_t>> index;  /// (frameCnt, offset) since the last index record
+    uint64_t lastIndex = 0;                        /// offset of the last index record (0: none)
+};
+
+/// @brief memory-mapped reader of a result log
+/// The frame offsets come from the index chain of a cleanly closed file, or from a walk over the record headers when
+/// the file has no footer (e.g. the writer was killed); a truncated last record is ignored.
+class ResultLogReader {
+   public:
+    ~ResultLogReader();
+
+    bool open(const std::string& filename);
+    void close();
+
+    const ResultLogHeader& getHeader() const {
+        return header;
+    }
+
+    /// number of frame records
+    size_t size() const {
+        return frames.size();
+    }
+
+    /// decode frame record i
+    bool read(size_t i, ResultFrame& frame) const;
+
+    /// index of the first frame record with frameCnt >= frameCnt (size(): none)
+    size_t find(uint frameCnt) const;
+
+   private:
+    bool indexFromFooter();
+    void indexFromRecords();
+
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mapHandle = nullptr;
+#endif
+
+    ResultLogHeader header{};
+    std::vector<std::pair<uint, uint64_t>> frames;  /// (frameCnt, offset) of the frame records
+};
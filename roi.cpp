@@ -0,0 +1,74 @@
+#include "roi.hpp"
+
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+using namespace cv;
+
+#define OD_ROI_MAX_AREA 0.8  // a crop larger than this fraction of the frame is not worth it
+
+bool OdRoi::init(const ODRecord& odRcd, int _vchID, cv::Size frameSize, int padding) {
+    vchID = _vchID;
+    rect = Rect();
+
+    Point tl(INT_MAX, INT_MAX), br(INT_MIN, INT_MIN);
+    auto add = [&](const Point& p) {
+        tl.x = std::min(tl.x, p.x);
+        tl.y = std::min(tl.y, p.y);
+        br.x = std::max(br.x, p.x);
+        br.y = std::max(br.y, p.y);
+    };
+
+    for (const Zone& zone : odRcd.zones)
+        if (zone.vchID == vchID)
+            for (const Point& p : zone.pts)
+                add(p);
+
+    for (const CntLine& cntLine : odRcd.cntLines) {
+        if (cntLine.vchID == vchID) {
+            add(cntLine.pts[0]);
+            add(cntLine.pts[1]);
+        }
+    }
+
+    if (tl.x > br.x)  // no geometry
+        return false;
+
+    Rect crop = Rect(tl - Point(padding, padding), br + Point(padding + 1, padding + 1)) &
+                Rect(Point(0, 0), frameSize);
+    if (crop.empty() || crop.area() > OD_ROI_MAX_AREA * frameSize.area())
+        return false;
+
+    rect = crop;
+    return true;
+}
+
+float OdRoi::scaleFactor(int netWidth, int netHeight) const {
+    return std::min({(float)netWidth / rect.width, (float)netHeight / rect.height, 1.0f});
+}
+
+void OdRoi::toFrame(std::span<DetBox> dboxes) const {
+    for (DetBox& d : dboxes) {
+        d.x += rect.x;
+        d.y += rect.y;
+        d.rx += rect.x;
+        d.ry += rect.y;
+        d.rxP += rect.x;
+        d.ryP += rect.y;
+    }
+}
+
+void OdRoi::shift(ODRecord& odRcd, cv::Point d) const {
+    for (Zone& zone : odRcd.zones)
+        if (zone.vchID == vchID)
+            for (Point& p : zone.pts)
+                p += d;
+
+    for (CntLine& cntLine : odRcd.cntLines) {
+        if (cntLine.vchID == vchID) {
+            cntLine.pts[0] += d;
+            cntLine.pts[1] += d;
+        }
+    }
+}
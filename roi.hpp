@@ -0,0 +1,47 @@
+#pragma once
+
+#include <span>
+
+#include <opencv2/core/core.hpp>
+
+#include "global.h"
+
+/// @brief OD crop of a channel: the padded bounding box of its zones and counting lines
+/// runModel gets the crop (a view of the frame, no copy) with odScaleFactors recomputed for the crop. The backend
+/// counts on the zones and counting lines, so they are shifted into crop coordinates for the call and back afterwards,
+/// together with the dboxes.
+class OdRoi {
+   public:
+    /// compute the crop (false: no geometry, or the crop covers most of the frame: OD keeps the whole frame)
+    bool init(const ODRecord& odRcd, int vchID, cv::Size frameSize, int padding);
+
+    bool enabled() const {
+        return !rect.empty();
+    }
+
+    const cv::Rect& getRect() const {
+        return rect;
+    }
+
+    /// od scale factor of the crop for a net of netWidth x netHeight (the crop is never upscaled)
+    float scaleFactor(int netWidth, int netHeight) const;
+
+    /// shift the zones and counting lines of the channel into crop coordinates
+    void toCrop(ODRecord& odRcd) const {
+        shift(odRcd, -rect.tl());
+    }
+
+    /// shift the zones and counting lines of the channel back into frame coordinates
+    void toFrame(ODRecord& odRcd) const {
+        shift(odRcd, rect.tl());
+    }
+
+    /// map dboxes of the crop into frame coordinates
+    void toFrame(std::span<DetBox> dboxes) const;
+
+   private:
+    void shift(ODRecord& odRcd, cv::Point d) const;
+
+    cv::Rect rect;  /// crop in frame coordinates (empty: whole frame)
+    int vchID = -1;
+};
@@ -0,0 +1,145 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+
+#include <opencv2/imgproc.hpp>
+
+using namespace std;
+using namespace cv;
+using namespace std::chrono;
+
+void InferScheduler::init(const Config& cfg) {
+    fdPeriod = std::max(cfg.fdPeriod, 1);
+    ccPeriod = std::max(cfg.ccPeriod, 1);
+    ccMaxPeriod = std::max(cfg.ccMaxPeriod, ccPeriod);
+    fdScoreThFire = std::max(cfg.fdScoreThFire, 1e-3f);
+    fdScoreThSmoke = std::max(cfg.fdScoreThSmoke, 1e-3f);
+    sceneChangeTh = cfg.fdSceneChangeTh;
+
+    channels.assign(cfg.numChannels, Channel{});
+    for (Channel& ch : channels) {
+        ch.fdPeriod = fdPeriod;
+        ch.ccPeriod = ccPeriod;
+        ch.fdWait = fdPeriod;  // both run on the first frame
+        ch.ccWait = ccPeriod;
+    }
+
+    budget = (float)std::max(cfg.inferBudget, 0);
+    tokens = budget * SCHED_BUDGET_BURST;
+    lastRefill = steady_clock::now();
+}
+
+void InferScheduler::plan(int vchID, const cv::Mat& frame, bool fdOn, bool ccOn, bool& runFD, bool& runCC) {
+    Channel& ch = channels[vchID];
+    runFD = runCC = false;
+
+    if (budget > 0) {
+        steady_clock::time_point now = steady_clock::now();
+        float burst = std::max(budget * SCHED_BUDGET_BURST, 1.0f);
+        tokens = std::min(tokens + budget * duration_cast<microseconds>(now - lastRefill).count() / 1e6f, burst);
+        lastRefill = now;
+    }
+
+    if (fdOn) {
+        bool urgent = sceneChanged(ch, frame) || ch.fdAlert;
+        bool due = ++ch.fdWait >= ch.fdPeriod;
+
+        if (urgent || due) {
+            runFD = take(urgent);
+            if (runFD) {
+                ch.fdWait = 0;
+                swap(ch.thumb, ch.lastThumb);  // the next scene change is measured against this frame
+            }
+            else {
+                ch.deferred++;
+            }
+        }
+    }
+
+    if (ccOn && ++ch.ccWait >= ch.ccPeriod) {
+        runCC = take(false);
+        if (runCC)
+            ch.ccWait = 0;
+        else
+            ch.deferred++;
+    }
+
+    ch.runs += runFD + runCC;
+}
+
+void InferScheduler::updateFD(int vchID, const FDRecord& fdRcd) {
+    Channel& ch = channels[vchID];
+    if (fdRcd.fireProbs.empty() || fdRcd.smokeProbs.empty())
+        return;
+
+    // probabilities as fractions of their thresholds: the last one and the average of the window before it
+    auto level = [this](float fire, float smoke) { return std::max(fire / fdScoreThFire, smoke / fdScoreThSmoke); };
+    float last = level(fdRcd.fireProbs.back(), fdRcd.smokeProbs.back());
+
+    size_t n = std::min(fdRcd.fireProbs.size(), fdRcd.smokeProbs.size()) - 1;
+    float avg = 0.0f;
+    for (size_t i = 0; i < n; i++)
+        avg += level(fdRcd.fireProbs[i], fdRcd.smokeProbs[i]);
+    avg = n > 0 ? avg / n : last;
+
+    ch.fdAlert = last >= SCHED_FD_ALERT_LEVEL || last - avg >= SCHED_FD_RISE;
+    ch.fdPeriod = ch.fdAlert ? 1 : std::min(ch.fdPeriod * 2, fdPeriod);
+}
+
+void InferScheduler::updateCC(int vchID, const CCRecord& ccRcd) {
+    Channel& ch = channels[vchID];
+
+    bool stable = !ccRcd.ccZones.empty();
+    for (const CCZone& ccZone : ccRcd.ccZones) {
+        if (ccZone.ccNums.empty())
+            continue;
+
+        auto [minIt, maxIt] = std::minmax_element(ccZone.ccNums.begin(), ccZone.ccNums.end());
+        float mean = 0.0f;
+        for (int ccNum : ccZone.ccNums)
+            mean += ccNum;
+        mean /= ccZone.ccNums.size();
+
+        if (*maxIt - *minIt > std::max(1.0f, mean * SCHED_CC_STABLE_FRAC)) {
+            stable = false;
+            break;
+        }
+    }
+
+    ch.ccPeriod = stable ? std::min(ch.ccPeriod * 2, ccMaxPeriod) : ccPeriod;
+}
+
+bool InferScheduler::sceneChanged(Channel& ch, const cv::Mat& frame) {
+    if (sceneChangeTh <= 0.0f || frame.empty())
+        return false;
+
+    // nearest sampling: a few thousand pixels read, whatever the resolution
+    Size thumbSize(SCHED_THUMB_WIDTH, std::max(frame.rows * SCHED_THUMB_WIDTH / frame.cols, 1));
+    resize(frame, ch.small, thumbSize, 0, 0, INTER_NEAREST);
+    if (ch.small.channels() == 3)
+        cvtColor(ch.small, ch.thumb, COLOR_BGR2GRAY);
+    else
+        ch.small.copyTo(ch.thumb);
+
+    if (ch.lastThumb.size() != ch.thumb.size())
+        return false;  // no FD frame to compare with yet (the first FD is due anyway)
+
+    return norm(ch.thumb, ch.lastThumb, NORM_L1) / ch.thumb.total() >= sceneChangeTh;
+}
+
+bool InferScheduler::take(bool force) {
+    if (budget <= 0)
+        return true;
+
+    if (tokens >= 1.0f) {
+        tokens -= 1.0f;
+        return true;
+    }
+
+    if (force && tokens > 1.0f - std::max(budget * SCHED_BUDGET_BURST, 1.0f)) {  // overdraw by at most one burst
+        tokens -= 1.0f;
+        return true;
+    }
+
+    return false;
+}
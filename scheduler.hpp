@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+
+#include "global.h"
+
+#define SCHED_THUMB_WIDTH 64       /// width of the gray thumbnail compared for scene changes
+#define SCHED_FD_ALERT_LEVEL 0.5f  /// fire or smoke probability (fraction of its threshold) that puts FD on alert
+#define SCHED_FD_RISE 0.2f         /// rise of that fraction over the window average that puts FD on alert
+#define SCHED_CC_STABLE_FRAC 0.1f  /// ccNums of a zone are stable when their range is within this fraction of the mean
+#define SCHED_BUDGET_BURST 0.5f    /// seconds of budget that can be spent at once
+
+/// @brief adaptive FD and CC scheduler shared by all channels
+/// FD of a channel runs every fdPeriod frames, on every frame while the fire or smoke probability rises (alert), and
+/// on the next frame when the scene changed since the last FD (mean gray level difference of a SCHED_THUMB_WIDTH
+/// thumbnail). After an alert the period doubles back to fdPeriod. CC runs every ccPeriod frames, and the period
+/// doubles up to ccMaxPeriod while ccNums of every zone are stable.
+/// All runs draw from one token bucket refilled with inferBudget inferences per second: a due run waits for a token
+/// (it stays due), while alert and scene-change FD runs always go and may overdraw the bucket by one burst.
+class InferScheduler {
+   public:
+    /// take the FD and CC periods of cfg (call before initModel, then set cfg.fdPeriod and cfg.ccPeriod to 1 so that
+    /// the backend does not skip frames on top of the scheduler, see main.cpp)
+    void init(const Config& cfg);
+
+    /// decide FD and CC of a frame of vchID (call once per frame; fdOn, ccOn: enabled for the channel)
+    void plan(int vchID, const cv::Mat& frame, bool fdOn, bool ccOn, bool& runFD, bool& runCC);
+
+    /// feed the FD result of vchID (after the inference wrote fdRcd)
+    void updateFD(int vchID, const FDRecord& fdRcd);
+
+    /// feed the CC result of vchID (after the inference updated ccNums)
+    void updateCC(int vchID, const CCRecord& ccRcd);
+
+    int getFdPeriod(int vchID) const {
+        return channels[vchID].fdPeriod;
+    }
+
+    int getCcPeriod(int vchID) const {
+        return channels[vchID].ccPeriod;
+    }
+
+    /// frames whose due FD or CC waited for the budget
+    uint64_t getDeferred(int vchID) const {
+        return channels[vchID].deferred;
+    }
+
+    /// inferences run (FD and CC) of vchID
+    uint64_t getRuns(int vchID) const {
+        return channels[vchID].runs;
+    }
+
+   private:
+    struct Channel {
+        int fdPeriod = 1;  /// current FD period (frames)
+        int ccPeriod = 1;  /// current CC period (frames)
+        int fdWait = 0;    /// frames since the last FD
+        int ccWait = 0;    /// frames since the last CC
+        bool fdAlert = false;
+        cv::Mat small, thumb, lastThumb;  /// thumbnail of the frame and of the last FD frame
+        uint64_t deferred = 0;
+        uint64_t runs = 0;
+    };
+
+    bool sceneChanged(Channel& ch, const cv::Mat& frame);
+    bool take(bool force);
+
+    std::vector<Channel> channels;
+    int fdPeriod = 1, ccPeriod = 1, ccMaxPeriod = 1;
+    float fdScoreThFire = 1.0f, fdScoreThSmoke = 1.0f;
+    float sceneChangeTh = 0.0f;
+
+    float budget = 0.0f;  /// inferences per second over all channels (0: unlimited)
+    float tokens = 0.0f;
+    std::chrono::steady_clock::time_point lastRefill;
+};
@@ -0,0 +1,100 @@
+/*==============================================================================
+* Copyright 2024 AIPro Inc.
+* Author: Chun-Su Park (cspk@skku.edu)
+=============================================================================*/
+// Convert a result log (see ResultLogWriter) to JSON lines, one frame per line
+// usage: resultlog2jsonl <input.irl> [output.jsonl] (default: stdout)
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "resultlog.hpp"
+
+using namespace std;
+
+static string toJson(const ResultLogHeader& header, const ResultFrame& frame) {
+    string line = std::format("{{\"vchID\":{},\"frameCnt\":{},\"timeUs\":{}", header.vchID, frame.frameCnt,
+        frame.timeUs);
+
+    if (frame.flags & RLOG_HAS_OD) {
+        line += ",\"dboxes\":[";
+        for (size_t b = 0; b < frame.dboxes.size(); b++) {
+            const DetBox& d = frame.dboxes[b];
+            line += std::format("{}{{\"trackID\":{},\"x\":{},\"y\":{},\"w\":{},\"h\":{},\"rx\":{},\"ry\":{},"
+                                "\"objID\":{},\"prob\":{:.4f}",
+                b > 0 ? "," : "", d.trackID, d.x, d.y, d.w, d.h, d.rx, d.ry, d.objID, d.prob);
+
+            if (frame.flags & RLOG_HAS_ATTS) {
+                line += ",\"atts\":[";
+                for (int a = 0; a < NUM_ATTRIBUTES; a++)
+                    line += std::format("{}{:.3f}", a > 0 ? "," : "", d.patts.atts[a]);
+                line += "]";
+            }
+            line += "}";
+        }
+        line += "]";
+    }
+
+    if (frame.flags & RLOG_HAS_FD)
+        line += std::format(",\"fd\":{{\"fire\":{:.4f},\"smoke\":{:.4f}}}", frame.fireProb, frame.smokeProb);
+
+    if (frame.flags & RLOG_HAS_CC) {
+        line += ",\"cc\":[";
+        for (size_t z = 0; z < frame.ccZones.size(); z++)
+            line += std::format("{}{{\"ccNum\":{},\"ccLevel\":{}}}", z > 0 ? "," : "", frame.ccZones[z].first,
+                frame.ccZones[z].second);
+        line += "]";
+    }
+
+    if (frame.flags & RLOG_HAS_COUNTERS) {
+        line += ",\"zones\":[";
+        for (size_t z = 0; z < frame.zones.size(); z++)
+            line += std::format("{}{{\"zoneID\":{},\"current\":{},\"total\":{}}}", z > 0 ? "," : "",
+                frame.zones[z].zoneID, frame.zones[z].current, frame.zones[z].total);
+
+        line += "],\"lines\":[";
+        for (size_t l = 0; l < frame.lines.size(); l++)
+            line += std::format("{}{{\"clineID\":{},\"totalUL\":{},\"totalDR\":{}}}", l > 0 ? "," : "",
+                frame.lines[l].clineID, frame.lines[l].totalUL, frame.lines[l].totalDR);
+        line += "]";
+    }
+
+    return line + "}\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cout << "usage: resultlog2jsonl <input.irl> [output.jsonl]\n";
+        return -1;
+    }
+
+    ResultLogReader reader;
+    if (!reader.open(argv[1])) {
+        cout << std::format("Cannot read a result log: {}\n", argv[1]);
+        return -1;
+    }
+
+    ofstream file;
+    if (argc > 2) {
+        file.open(argv[2]);
+        if (!file) {
+            cout << std::format("Cannot write {}\n", argv[2]);
+            return -1;
+        }
+    }
+    ostream& out = argc > 2 ? file : cout;
+
+    ResultFrame frame;
+    size_t bad = 0;
+    for (size_t i = 0; i < reader.size(); i++) {
+        if (reader.read(i, frame))
+            out << toJson(reader.getHeader(), frame);
+        else
+            bad++;
+    }
+
+    if (bad > 0)
+        cerr << std::format("{} corrupt records skipped\n", bad);
+    return 0;
+}
@@ -0,0 +1,77 @@
+/*==============================================================================
+* Copyright 2024 AIPro Inc.
+* Author: Chun-Su Park (cspk@skku.edu)
+=============================================================================*/
+// Convert a video (any input of cv::VideoCapture) to a raw replay file (see ReplayReader), decoded once, so that runs
+// reading it (VideoStreamer, scaling_sweep) are decode-free and deterministic
+// usage: video2replay <input> <output.rpl> [--nv12] [--frames=N]   (--nv12: half the size, converted to BGR on read)
+#include <format>
+#include <iostream>
+#include <string>
+
+#include <opencv2/videoio.hpp>
+
+#include "replay.hpp"
+
+using namespace std;
+using namespace cv;
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        cout << "usage: video2replay <input> <output.rpl> [--nv12] [--frames=N]\n";
+        return -1;
+    }
+
+    int pixFmt = PIX_FMT_BGR;
+    long long maxFrames = -1;
+    for (int i = 3; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--nv12")
+            pixFmt = PIX_FMT_NV12;
+        else if (arg.starts_with("--frames="))
+            maxFrames = stoll(arg.substr(9));
+        else {
+            cout << std::format("Unknown option: {}\n", arg);
+            return -1;
+        }
+    }
+
+    VideoCapture capture(argv[1]);
+    if (!capture.isOpened()) {
+        cout << std::format("Cannot open {}\n", argv[1]);
+        return -1;
+    }
+
+    int width = (int)capture.get(CAP_PROP_FRAME_WIDTH);
+    int height = (int)capture.get(CAP_PROP_FRAME_HEIGHT);
+    float fps = (float)capture.get(CAP_PROP_FPS);
+    if (pixFmt == PIX_FMT_NV12 && (width % 2 || height % 2)) {
+        cout << std::format("NV12 needs an even frame size: {}x{}\n", width, height);
+        return -1;
+    }
+
+    ReplayWriter writer;
+    if (!writer.open(argv[2], width, height, pixFmt, fps)) {
+        cout << std::format("Cannot write {}\n", argv[2]);
+        return -1;
+    }
+
+    Mat frame;
+    long long numFrames = 0;
+    while ((maxFrames < 0 || numFrames < maxFrames) && capture.read(frame)) {
+        if (!writer.write(frame)) {
+            cout << std::format("Cannot write frame {} ({}x{})\n", numFrames, frame.cols, frame.rows);
+            return -1;
+        }
+        numFrames++;
+    }
+
+    if (!writer.close()) {
+        cout << std::format("Cannot finish {}\n", argv[2]);
+        return -1;
+    }
+
+    cout << std::format("{}: {} frames of {}x{} {} at {:.2f} fps\n", argv[2], numFrames, width, height,
+        pixFmt == PIX_FMT_NV12 ? "NV12" : "BGR", fps);
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "trace.hpp"
+
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+namespace {
+
+/// per-thread span buffer: written only by its thread, read by Tracer::write up to the published count
+struct TraceBuffer {
+    vector<TraceEvent> events;
+    atomic<size_t> count{0};
+    atomic<uint64_t> dropped{0};
+    int tid;
+};
+
+struct TraceRegistry {
+    mutex m;
+    vector<unique_ptr<TraceBuffer>> buffers;  /// never freed while tracing: threads may exit before write
+    unordered_map<int, string> threadNames;
+    atomic<int64_t> beginUs{0};
+    atomic<int64_t> endUs{0};
+};
+
+TraceRegistry& registry() {
+    static TraceRegistry r;
+    return r;
+}
+
+thread_local TraceBuffer* localBuffer = nullptr;
+
+TraceBuffer* getLocalBuffer() {
+    if (!localBuffer) {
+        TraceRegistry& r = registry();
+        auto buf = make_unique<TraceBuffer>();
+        buf->events.resize(Tracer::BUFFER_CAPACITY);
+
+        lock_guard<mutex> lock(r.m);
+        buf->tid = (int)r.buffers.size() + 1;
+        localBuffer = buf.get();
+        r.buffers.push_back(std::move(buf));
+    }
+
+    return localBuffer;
+}
+
+}  // namespace
+
+std::atomic<bool> Tracer::active{false};
+
+void Tracer::start(double startSec, double durationSec) {
+    TraceRegistry& r = registry();
+    int64_t now = toUs(steady_clock::now());
+
+    r.beginUs = now + (int64_t)(startSec * 1e6);
+    r.endUs = now + (int64_t)((startSec + durationSec) * 1e6);
+    active = true;
+}
+
+bool Tracer::finished() {
+    return active && toUs(steady_clock::now()) > registry().endUs;
+}
+
+void Tracer::nameThread(int tid, const char* name) {
+    TraceRegistry& r = registry();
+    if (tid == TRACE_TID_SELF)
+        tid = getLocalBuffer()->tid;
+
+    lock_guard<mutex> lock(r.m);
+    r.threadNames[tid] = name;
+}
+
+void Tracer::record(const char* name, int tid, int64_t beginUs, int64_t endUs, int vchID, uint frameCnt) {
+    if (!enabled())
+        return;
+
+    TraceRegistry& r = registry();
+    if (beginUs < r.beginUs.load(memory_order_relaxed) || endUs > r.endUs.load(memory_order_relaxed))
+        return;
+
+    TraceBuffer* buf = getLocalBuffer();
+    size_t n = buf->count.load(memory_order_relaxed);
+    if (n >= buf->events.size()) {
+        buf->dropped.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+
+    buf->events[n] = TraceEvent{name, beginUs, endUs - beginUs, tid == TRACE_TID_SELF ? buf->tid : tid, vchID, frameCnt};
+    buf->count.store(n + 1, memory_order_release);
+}
+
+bool Tracer::write(const std::string& filename) {
+    TraceRegistry& r = registry();
+    ofstream out(filename);
+    if (!out) {
+        cout << std::format("Tracer: cannot open {}\n", filename);
+        return false;
+    }
+
+    int64_t base = r.beginUs;
+    size_t numEvents = 0;
+    uint64_t numDropped = 0;
+    bool first = true;
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    lock_guard<mutex> lock(r.m);
+    for (auto& [tid, name] : r.threadNames) {
+        out << std::format("{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+            first ? "" : ",\n", tid, name);
+        first = false;
+    }
+
+    for (auto& buf : r.buffers) {
+        size_t n = buf->count.load(memory_order_acquire);
+        for (size_t i = 0; i < n; i++) {
+            const TraceEvent& e = buf->events[i];
+            out << std::format("{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{},\"dur\":{},"
+                               "\"args\":{{\"vchID\":{},\"frameCnt\":{}}}}}",
+                first ? "" : ",\n", e.name, e.tid, e.ts - base, e.dur, e.vchID, e.frameCnt);
+            first = false;
+        }
+
+        numEvents += n;
+        numDropped += buf->dropped;
+    }
+
+    out << "\n]}\n";
+
+    cout << std::format("Tracer: {} spans written to {} ({} dropped)\n", numEvents, filename, numDropped);
+    return (bool)out;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "global.h"
+
+/// one complete span ("X" event of the Chrome trace format)
+struct TraceEvent {
+    const char* name;  /// string literal (not copied)
+    int64_t ts;        /// begin time(us, steady clock)
+    int64_t dur;       /// duration(us)
+    int tid;           /// track of the span
+    int vchID;
+    uint frameCnt;
+};
+
+/// tracks for spans recorded on behalf of other threads (e.g. inferences running on backend worker threads)
+#define TRACE_TID_SELF 0  /// track of the calling thread
+#define TRACE_TID_OD 1001
+#define TRACE_TID_FD 1002
+#define TRACE_TID_CC 1003
+
+/// @brief span tracer exporting Chrome/Perfetto trace JSON (chrome://tracing, ui.perfetto.dev)
+/// Each thread appends to its own preallocated buffer (single writer, published with a release store), so recording
+/// takes no lock and no allocation. Only spans inside the time window set by start are kept; spans that do not fit in
+/// a full buffer are dropped and counted.
+class Tracer {
+   public:
+    static constexpr size_t BUFFER_CAPACITY = 1 << 16;  /// spans per thread
+
+    /// keep the spans of [now + startSec, now + startSec + durationSec]
+    static void start(double startSec, double durationSec);
+
+    /// true once the time window is over
+    static bool finished();
+
+    /// write the kept spans as Chrome trace JSON (ts relative to the window begin)
+    static bool write(const std::string& filename);
+
+    /// name a track in the trace (TRACE_TID_SELF: the calling thread)
+    static void nameThread(int tid, const char* name);
+
+    static void record(const char* name, int tid, int64_t beginUs, int64_t endUs, int vchID, uint frameCnt);
+
+    static void record(const char* name, int tid, std::chrono::steady_clock::time_point begin,
+        std::chrono::steady_clock::time_point end, int vchID, uint frameCnt) {
+        record(name, tid, toUs(begin), toUs(end), vchID, frameCnt);
+    }
+
+    static bool enabled() {
+        return active.load(std::memory_order_relaxed);
+    }
+
+    static int64_t toUs(std::chrono::steady_clock::time_point tp) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(tp.time_since_epoch()).count();
+    }
+
+   private:
+    static std::atomic<bool> active;
+};
+
+/// RAII span on the calling thread
+class TraceSpan {
+   public:
+    TraceSpan(const char* name, int vchID, uint frameCnt) : name(name), vchID(vchID), frameCnt(frameCnt) {
+        if (Tracer::enabled())
+            begin = std::chrono::steady_clock::now();
+    }
+
+    ~TraceSpan() {
+        if (Tracer::enabled() && begin.time_since_epoch().count() != 0)
+            Tracer::record(name, TRACE_TID_SELF, begin, std::chrono::steady_clock::now(), vchID, frameCnt);
+    }
+
+   private:
+    const char* name;
+    int vchID;
+    uint frameCnt;
+    std::chrono::steady_clock::time_point begin{};
+};
+
+// compile-time switch: define _TRACE (ENABLE_TRACE in CMakeLists.txt) to record spans
+#define TRACE_CAT_(a, b) a##b
+#define TRACE_CAT(a, b) TRACE_CAT_(a, b)
+
+#ifdef _TRACE
+#define TRACE_SPAN(name, vchID, frameCnt) TraceSpan TRACE_CAT(traceSpan, __LINE__)(name, vchID, frameCnt)
+#define TRACE_RECORD(name, tid, begin, end, vchID, frameCnt) Tracer::record(name, tid, begin, end, vchID, frameCnt)
+#else
+#define TRACE_SPAN(name, vchID, frameCnt)
+#define TRACE_RECORD(name, tid, begin, end, vchID, frameCnt)
+#endif
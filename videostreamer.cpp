@@ -1,5 +1,6 @@
 #include "videostreamer.hpp"
 
+#include <cstring>
 #include <string>
 
 #include "opencv2/opencv.hpp"
@@ -14,6 +15,10 @@ VideoStreamer::VideoStreamer(Config& cfg, std::vector<CInfo>& cInfo) {
 
     videoWriters.resize(numChannels);
     captures.resize(numChannels);
+    hashes.resize(numChannels);
+    replays.resize(numChannels);
+    replayPos.assign(numChannels, 0);
+    replayBufs.resize(numChannels);
 
     init(cInfo);
 }
@@ -24,6 +29,9 @@ VideoStreamer::~VideoStreamer() {
 void VideoStreamer::destroy() {
     for (auto& capture : captures)
         capture.release();
+    for (auto& replay : replays)
+        if (replay)
+            replay->close();
 
     if (pCfg->recording) {
         for (auto& videoWriter : videoWriters)
@@ -41,16 +49,34 @@ void VideoStreamer::init(std::vector<CInfo>& cInfo) {
             return;
         }
 
-        cv::VideoCapture& capture = captures[vchID];
-        capture.open(input);  // opencv capture ü 
+        // raw replay (memory-mapped, no decoding) or a video/stream opened by VideoCapture
+        bool opened;
+        int frameWidth = 0, frameHeight = 0;
+        float fps = 0.0f;
+        if (input.ends_with(REPLAY_EXT)) {
+            replays[vchID] = make_unique<ReplayReader>();
+            opened = replays[vchID]->open(input);
+            if (opened) {
+                const ReplayHeader& header = replays[vchID]->getHeader();
+                frameWidth = header.width;
+                frameHeight = header.height;
+                fps = header.fps;
+            }
+        }
+        else {
+            cv::VideoCapture& capture = captures[vchID];
+            capture.open(input);  // opencv capture ü 
+            opened = capture.isOpened();
+            if (opened) {
+                frameWidth = capture.get(CAP_PROP_FRAME_WIDTH);
+                frameHeight = capture.get(CAP_PROP_FRAME_HEIGHT);
+                fps = capture.get(CAP_PROP_FPS);
+            }
+        }
 
-        if (capture.isOpened()) {  // Ϸ
+        if (opened) {  // Ϸ
             cout << std::format("[{}] Open: {}\n", vchID, input);
 
-            int frameWidth = capture.get(CAP_PROP_FRAME_WIDTH);
-            int frameHeight = capture.get(CAP_PROP_FRAME_HEIGHT);
-            float fps = capture.get(CAP_PROP_FPS);
-
             pCfg->frameHeights[vchID] = frameHeight;
             pCfg->frameWidths[vchID] = frameWidth;
             pCfg->fpss[vchID] = fps;
@@ -141,11 +167,98 @@ void VideoStreamer::init(std::vector<CInfo>& cInfo) {
 }
 
 bool VideoStreamer::read(Mat& frame, int vchID) {
-    cv::VideoCapture& capture = captures[vchID];
-    capture.read(frame);
+    if (replays[vchID]) {
+        ReplayReader& replay = *replays[vchID];
+        if (replayPos[vchID] > 0)
+            replay.release(replayPos[vchID] - 1);  // the previous frame is done (drop the pages drawn on)
+        if (replayPos[vchID] >= replay.size())
+            return false;
+        frame = replay.read(replayPos[vchID]++, replayBufs[vchID]);  // a view of the mapping (BGR replays)
+    }
+    else {
+        cv::VideoCapture& capture = captures[vchID];
+        capture.read(frame);
+    }
 
     if (frame.empty())
         return false;
 
+    if (pCfg->dupDetection)
+        hash(frame, vchID);
+
     return true;
 }
+
+float VideoStreamer::getFrozenSec(int vchID) const {
+    float fps = pCfg->fpss[vchID] > 0 ? pCfg->fpss[vchID] : 30.0f;
+    return hashes[vchID].unchangedFrames / fps;
+}
+
+/// 64-bit hash of all pixels of a frame (row by row, so views of a larger frame are hashed in place; four
+/// independent lanes keep the multiplies in flight)
+static uint64_t hashPixels(const Mat& frame) {
+    const uint64_t k = 0x9e3779b97f4a7c15ULL;
+    uint64_t lanes[4] = {k, k * 3, k * 5, k * 7};
+    size_t rowBytes = frame.cols * frame.elemSize();
+
+    for (int y = 0; y < frame.rows; y++) {
+        const uchar* p = frame.ptr(y);
+        size_t i = 0;
+
+        for (; i + 32 <= rowBytes; i += 32) {
+            for (int l = 0; l < 4; l++) {
+                uint64_t v;
+                memcpy(&v, p + i + 8 * l, 8);
+                lanes[l] = (lanes[l] ^ v) * k;
+                lanes[l] ^= lanes[l] >> 29;
+            }
+        }
+
+        for (; i < rowBytes; i++)
+            lanes[0] = (lanes[0] ^ p[i]) * k;
+    }
+
+    uint64_t h = (uint64_t)frame.rows << 32 ^ (uint64_t)frame.cols << 8 ^ (uint64_t)frame.type();
+    for (int l = 0; l < 4; l++) {
+        h = (h ^ lanes[l]) * k;
+        h ^= h >> 31;
+    }
+    return h;
+}
+
+void VideoStreamer::hash(const Mat& frame, int vchID) {
+    FrameHash& h = hashes[vchID];
+    h.event = STREAM_EVENT_NONE;
+
+    // duplicate: exact repeat of the previous frame (its results are reused)
+    uint64_t pixelHash = hashPixels(frame);
+    h.duplicate = pixelHash == h.pixelHash;
+    h.pixelHash = pixelHash;
+    if (h.duplicate)
+        h.duplicates++;
+
+    // frozen: no visible change for frozenSec (reported only, a static scene is not a duplicate)
+    Size thumbSize(FRAME_THUMB_WIDTH, std::max(frame.rows * FRAME_THUMB_WIDTH / frame.cols, 1));
+    resize(frame, h.small, thumbSize, 0, 0, INTER_AREA);
+    if (h.small.channels() == 3)
+        cvtColor(h.small, h.gray, COLOR_BGR2GRAY);
+    else
+        h.small.copyTo(h.gray);
+
+    bool unchanged = h.last.size() == h.gray.size() && norm(h.gray, h.last, NORM_INF) <= pCfg->frozenFrameTh;
+    if (!unchanged) {
+        swap(h.gray, h.last);
+        h.unchangedFrames = 0;
+        if (h.frozen) {
+            h.frozen = false;
+            h.event = STREAM_EVENT_RECOVERED;
+        }
+        return;
+    }
+
+    h.unchangedFrames++;
+    if (!h.frozen && pCfg->frozenSec > 0 && getFrozenSec(vchID) >= pCfg->frozenSec) {
+        h.frozen = true;
+        h.event = STREAM_EVENT_FROZEN;
+    }
+}
@@ -5,6 +5,7 @@
 #endif
 
 #include <iostream>
+#include <memory>
 #include <opencv2/videoio.hpp>
 #include <string>
 #include <thread>
@@ -15,11 +16,19 @@
 #endif
 
 #include "global.h"
+#include "replay.hpp"
 #include "util.h"
 
 using namespace std;
 using namespace cv;
 
+#define FRAME_THUMB_WIDTH 64  /// width of the block-mean luma grid of a frame (height keeps the aspect ratio)
+
+/// STREAM_EVENT (health events of an input stream, see VideoStreamer::getEvent)
+#define STREAM_EVENT_NONE 0
+#define STREAM_EVENT_FROZEN 1     /// the frame has not changed for cfg.frozenSec seconds
+#define STREAM_EVENT_RECOVERED 2  /// a frozen stream changed again
+
 class VideoStreamer {
    public:
     Config *pCfg;
@@ -30,6 +39,7 @@ class VideoStreamer {
 
     vector<VideoWriter> videoWriters;
     vector<VideoCapture> captures;
+    vector<unique_ptr<ReplayReader>> replays;  /// inputs ending with REPLAY_EXT (nullptr: captured input)
 
     VideoStreamer(Config &cfg, std::vector<CInfo> &cInfo);
     ~VideoStreamer();
@@ -37,8 +47,48 @@ class VideoStreamer {
     void destroy();  // explicit destroy function. (cuz destructor is called randomly)
     bool read(Mat &frame, int vchID);
 
+    /// the last frame read from vchID repeats the previous one byte for byte (cfg.dupDetection; the OD and CC results
+    /// of the previous frame can be reused without inference)
+    bool isDuplicate(int vchID) const {
+        return hashes[vchID].duplicate;
+    }
+
+    /// health event raised by the last frame read from vchID (STREAM_EVENT_*, for reporting: a static scene also
+    /// freezes)
+    int getEvent(int vchID) const {
+        return hashes[vchID].event;
+    }
+
+    /// seconds (stream time) the input of vchID has been frozen
+    float getFrozenSec(int vchID) const;
+
+    /// duplicate frames read from vchID
+    uint64_t getDuplicates(int vchID) const {
+        return hashes[vchID].duplicates;
+    }
+
    private:
+    /// per-channel frame state
+    /// - duplicate: a 64-bit hash of all pixels equals the one of the previous frame (exact repeat)
+    /// - frozen: the luma of the frame averaged over FRAME_THUMB_WIDTH blocks per row (resize with INTER_AREA and
+    ///   cvtColor, both SIMD) differs by no more than cfg.frozenFrameTh gray levels from the last change, which
+    ///   absorbs the noise of re-encoding a resent frame, for cfg.frozenSec
+    struct FrameHash {
+        uint64_t pixelHash = 0;  /// hash of the previous frame
+        Mat small, gray, last;   /// block means of the frame, and of the last frame that changed
+        bool duplicate = false;
+        bool frozen = false;
+        int event = STREAM_EVENT_NONE;
+        int unchangedFrames = 0;  /// frames within cfg.frozenFrameTh of the last change
+        uint64_t duplicates = 0;
+    };
+
     void init(std::vector<CInfo> &cInfo);
+    void hash(const Mat &frame, int vchID);
+
+    vector<FrameHash> hashes;
+    vector<size_t> replayPos;  /// next frame of each replay
+    vector<Mat> replayBufs;    /// BGR conversion buffers of NV12 replays
 
    public:
     VideoWriter &operator[](int idx) {